@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <print>
+
+namespace bench {
+// keeps the optimizer from dropping a result
+template <class T>
+auto keep(const T& value) -> void {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// calls f(i) for i in [0, iterations) and prints the rate
+// bytes is the amount of data one call processes, 0 to print calls per second only
+template <class F>
+auto measure(const char* const name, const size_t iterations, const size_t bytes, F f) -> double {
+    const auto begin = std::chrono::steady_clock::now();
+    for(auto i = 0uz; i < iterations; i += 1) {
+        f(i);
+    }
+    const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    const auto rate    = iterations / elapsed;
+    if(bytes == 0) {
+        std::println("{:<40} {:>10.2f} Mop/s", name, rate / 1e6);
+    } else {
+        std::println("{:<40} {:>10.2f} Mop/s {:>10.1f} MiB/s", name, rate / 1e6, rate * bytes / (1024 * 1024));
+    }
+    return rate;
+}
+} // namespace bench
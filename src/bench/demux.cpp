@@ -0,0 +1,99 @@
+#include <random>
+#include <vector>
+
+#include "../jingle-handler/demux.hpp"
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+constexpr auto stream_count = 160uz;
+constexpr auto packet_count = 4096uz;
+constexpr auto packet_size  = 1200uz;
+
+auto make_packet(const uint8_t first, const uint8_t second, const uint32_t ssrc) -> std::vector<std::byte> {
+    auto data = std::vector<std::byte>(packet_size);
+    data[0]   = std::byte(first);
+    data[1]   = std::byte(second);
+    // rtp carries the media ssrc at 8, rtcp the sender ssrc at 4
+    const auto offset = second >= 192 && second <= 223 ? 4uz : 8uz;
+    for(auto i = 0uz; i < 4; i += 1) {
+        data[offset + i] = std::byte(ssrc >> (24 - i * 8));
+    }
+    return data;
+}
+} // namespace
+
+auto demux() -> bool {
+    constexpr auto iterations = 10'000'000uz;
+
+    auto ssrc_table = SharedSSRCTable();
+    auto rng        = std::mt19937(1);
+    auto ssrcs      = std::vector<uint32_t>(stream_count);
+    ssrc_table.update([&](SSRCTable& table) {
+        for(auto i = 0uz; i < stream_count; i += 1) {
+            ssrcs[i] = rng();
+            table.insert(Source{.ssrc = ssrcs[i], .type = i % 2 == 0 ? SourceType::Audio : SourceType::Video, .participant = uint32_t(i / 2)});
+        }
+    });
+
+    // mostly rtp, some rtcp, a little dtls and stun, and packets of unknown sources
+    auto packets = std::vector<std::vector<std::byte>>();
+    auto unknown = 0uz;
+    for(auto i = 0uz; i < packet_count; i += 1) {
+        const auto ssrc = ssrcs[rng() % stream_count];
+        switch(rng() % 100) {
+        case 0:
+            packets.push_back(make_packet(22, 254, 0)); // dtls application data
+            break;
+        case 1:
+            packets.push_back(make_packet(0, 1, 0)); // stun binding request
+            break;
+        case 2:
+            packets.push_back(make_packet(0x80, 96, uint32_t(rng())));
+            unknown += 1;
+            break;
+        case 3:
+        case 4:
+        case 5:
+        case 6:
+        case 7:
+        case 8:
+            packets.push_back(make_packet(0x81, 200, ssrc)); // sender report
+            break;
+        default:
+            packets.push_back(make_packet(0x80, 96, ssrc));
+            break;
+        }
+    }
+    const auto info = ice::PacketInfo{.arrival = std::chrono::steady_clock::now(), .len = packet_size};
+
+    measure("classify", iterations, 0, [&](const size_t i) {
+        keep(demux::classify(packets[i % packet_count]));
+    });
+
+    auto routed  = 0uz;
+    auto demuxer = demux::Demuxer{
+        .ssrc_table = &ssrc_table,
+        .on_rtp     = [&](const Source&, std::span<const std::byte>, const ice::PacketInfo&) { routed += 1; },
+        .on_rtcp    = [&](const Source&, std::span<const std::byte>, const ice::PacketInfo&) { routed += 1; },
+    };
+    const auto rate = measure("feed", iterations, 0, [&](const size_t i) {
+        demuxer.feed(packets[i % packet_count], info);
+    });
+    std::println("{} streams, {:.1f} Gbps of {} byte packets", stream_count, rate * packet_size * 8 / 1e9, packet_size);
+
+    // every packet of a known source is routed, the rest are counted
+    const auto rounds = iterations / packet_count;
+    const auto rest   = iterations % packet_count;
+    auto       expect = 0uz;
+    for(auto i = 0uz; i < packet_count; i += 1) {
+        const auto klass = demux::classify(packets[i]);
+        if(klass != demux::PacketClass::Rtp && klass != demux::PacketClass::Rtcp) {
+            continue;
+        }
+        const auto known = ssrc_table.load()->find(*demux::get_ssrc(packets[i], klass)) != nullptr;
+        expect += known ? rounds + (i < rest ? 1 : 0) : 0;
+    }
+    return routed == expect && demuxer.unknown_ssrc > 0 && unknown > 0;
+}
+} // namespace bench
@@ -0,0 +1,44 @@
+#include <cstring>
+#include <print>
+
+#include "bench.hpp"
+
+namespace bench {
+auto demux() -> bool;
+auto ssrc_table() -> bool;
+auto xml_escape() -> bool;
+} // namespace bench
+
+namespace {
+struct Bench {
+    const char* name;
+    auto (*run)() -> bool;
+};
+
+constexpr Bench benches[] = {
+    {"demux", bench::demux},
+    {"ssrc-table", bench::ssrc_table},
+    {"xml-escape", bench::xml_escape},
+};
+} // namespace
+
+// usage: bench [NAME...]
+// runs every benchmark when no name is given
+auto main(const int argc, const char* const* argv) -> int {
+    auto ok = true;
+    for(const auto& bench : benches) {
+        auto selected = argc <= 1;
+        for(auto i = 1; i < argc; i += 1) {
+            selected |= std::strcmp(argv[i], bench.name) == 0;
+        }
+        if(!selected) {
+            continue;
+        }
+        std::println("== {}", bench.name);
+        if(!bench.run()) {
+            std::println("{}: check failed", bench.name);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,91 @@
+#include <format>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../jingle-handler/ssrc-table.hpp"
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+constexpr auto source_count = 2000uz;
+
+// the layout SSRCTable replaced, every source owned its participant id
+struct OldSource {
+    uint32_t    ssrc;
+    SourceType  type;
+    std::string participant_id;
+};
+
+using OldSSRCMap = std::unordered_map<uint32_t, OldSource>;
+
+// random inserts, erases and lookups against std::unordered_map
+auto differential_check() -> bool {
+    auto table = SSRCTable();
+    auto map   = std::unordered_map<uint32_t, conference::ParticipantHandle>();
+    auto rng   = std::mt19937(1);
+    for(auto i = 0uz; i < 200'000; i += 1) {
+        // a small key space so that erases and replacements hit
+        const auto ssrc = uint32_t(rng() % (source_count * 3 / 2));
+        switch(rng() % 3) {
+        case 0:
+            table.insert(Source{.ssrc = ssrc, .type = SourceType::Audio, .participant = uint32_t(i)});
+            map[ssrc] = uint32_t(i);
+            break;
+        case 1:
+            if(table.erase(ssrc) != (map.erase(ssrc) != 0)) {
+                std::println("erase mismatch at {}", i);
+                return false;
+            }
+            break;
+        case 2: {
+            const auto source = table.find(ssrc);
+            const auto entry  = map.find(ssrc);
+            if((source != nullptr) != (entry != map.end()) || (source != nullptr && source->participant != entry->second)) {
+                std::println("find mismatch at {}", i);
+                return false;
+            }
+        } break;
+        }
+        if(table.size() != map.size()) {
+            std::println("size mismatch at {}", i);
+            return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+auto ssrc_table() -> bool {
+    constexpr auto iterations = 20'000'000uz;
+
+    auto rng   = std::mt19937(2);
+    auto table = SSRCTable();
+    auto map   = OldSSRCMap();
+    auto ssrcs = std::vector<uint32_t>(source_count);
+    for(auto i = 0uz; i < source_count; i += 1) {
+        ssrcs[i]          = rng();
+        const auto source = Source{.ssrc = ssrcs[i], .type = SourceType::Video, .participant = uint32_t(i)};
+        table.insert(source);
+        // endpoint ids as jicofo assigns them
+        map.emplace(source.ssrc, OldSource{.ssrc = source.ssrc, .type = source.type, .participant_id = std::format("{:08x}", rng())});
+    }
+    // lookup order of packets arriving from random sources, a tenth of them unknown
+    auto keys = std::vector<uint32_t>(4096);
+    for(auto& key : keys) {
+        key = rng() % 10 == 0 ? uint32_t(rng()) : ssrcs[rng() % source_count];
+    }
+    const auto mask = keys.size() - 1;
+
+    measure("SSRCTable::find", iterations, 0, [&](const size_t i) {
+        keep(table.find(keys[i & mask]));
+    });
+    measure("SSRCMap::find (old layout)", iterations, 0, [&](const size_t i) {
+        const auto it = map.find(keys[i & mask]);
+        keep(it != map.end() ? &it->second : nullptr);
+    });
+
+    return differential_check();
+}
+} // namespace bench
@@ -0,0 +1,89 @@
+#include <array>
+#include <string>
+
+#include "../xml-escape.hpp"
+#include "bench.hpp"
+
+namespace bench {
+namespace {
+auto repeat(const std::string_view unit, const size_t count) -> std::string {
+    auto str = std::string();
+    for(auto i = 0uz; i < count; i += 1) {
+        str += unit;
+    }
+    return str;
+}
+
+// the five pass implementation this replaced, kept as the baseline
+namespace old {
+auto replace(std::string str, const std::string_view from, const std::string_view to) -> std::string {
+    auto pos = 0uz;
+
+loop:
+    pos = str.find(from, pos);
+    if(pos == std::string::npos) {
+        return str;
+    }
+    str.replace(pos, from.size(), to);
+    pos += to.size();
+    goto loop;
+}
+
+const auto xml_escape_table = std::array{
+    std::pair("&", "&amp;"),
+    std::pair("<", "&lt;"),
+    std::pair(">", "&gt;"),
+    std::pair("\"", "&quot;"),
+    std::pair("'", "&apos;"),
+};
+
+auto xml_escape(std::string str) -> std::string {
+    for(auto i = xml_escape_table.begin(); i < xml_escape_table.end(); i += 1) {
+        str = replace(str, i->first, i->second);
+    }
+    return str;
+}
+
+auto xml_unescape(std::string str) -> std::string {
+    for(auto i = xml_escape_table.rbegin(); i < xml_escape_table.rend(); i += 1) {
+        str = replace(str, i->second, i->first);
+    }
+    return str;
+}
+} // namespace old
+} // namespace
+
+auto xml_escape() -> bool {
+    constexpr auto iterations = 1'000'000uz;
+
+    // typical attribute values and message bodies
+    const auto plain   = repeat("endpoint-id 0123abcd ", 8);
+    const auto sparse  = repeat("say \"hi\" to bob & alice ", 8);
+    const auto dense   = repeat("<&>\"'", 32);
+    const auto escaped = escape::xml_escape(sparse);
+
+    auto buf = std::string();
+    measure("escape plain", iterations, plain.size(), [&](size_t) { keep(escape::xml_escape(plain, buf)); });
+    measure("escape sparse", iterations, sparse.size(), [&](size_t) { keep(escape::xml_escape(sparse, buf)); });
+    measure("escape dense", iterations, dense.size(), [&](size_t) { keep(escape::xml_escape(dense, buf)); });
+    measure("unescape plain", iterations, plain.size(), [&](size_t) { keep(escape::xml_unescape(plain, buf)); });
+    measure("unescape sparse", iterations, escaped.size(), [&](size_t) { keep(escape::xml_unescape(escaped, buf)); });
+    // owning overloads, one allocation per call
+    measure("escape sparse (copy)", iterations, sparse.size(), [&](size_t) { keep(escape::xml_escape(sparse)); });
+
+    // baseline on the same inputs, takes a copy like the owning overloads
+    measure("old escape plain", iterations, plain.size(), [&](size_t) { keep(old::xml_escape(plain)); });
+    measure("old escape sparse", iterations, sparse.size(), [&](size_t) { keep(old::xml_escape(sparse)); });
+    measure("old escape dense", iterations, dense.size(), [&](size_t) { keep(old::xml_escape(dense)); });
+    measure("old unescape plain", iterations, plain.size(), [&](size_t) { keep(old::xml_unescape(plain)); });
+    measure("old unescape sparse", iterations, escaped.size(), [&](size_t) { keep(old::xml_unescape(escaped)); });
+
+    // round trip sanity check, and both implementations agree
+    for(const auto& str : {plain, sparse, dense, escaped}) {
+        if(escape::xml_escape(str) != old::xml_escape(str) || escape::xml_unescape(str) != old::xml_unescape(str)) {
+            return false;
+        }
+    }
+    return escape::xml_unescape(escaped) == sparse;
+}
+} // namespace bench
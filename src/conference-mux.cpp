@@ -0,0 +1,116 @@
+#include "conference-mux.hpp"
+#include "macros/logger.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "macros/unwrap.hpp"
+
+namespace conference {
+namespace {
+auto logger = Logger("mux");
+
+constexpr auto prefix_separator = ':';
+
+auto to_bare(const std::string_view jid) -> std::string_view {
+    return jid.substr(0, jid.find('/'));
+}
+} // namespace
+
+auto Mux::add(Conference& conf) -> bool {
+    auto room = conf.config.get_muc_jid().as_bare();
+    ensure(!rooms.contains(room), "room {} is already joined", room);
+    if(conferences.empty()) {
+        keepalive.last_received = std::chrono::steady_clock::now();
+    }
+    conf.iq_id_prefix = std::format("m{}{}", serial += 1, prefix_separator);
+    prefixes.emplace(conf.iq_id_prefix, &conf);
+    rooms.emplace(std::move(room), &conf);
+    conferences.push_back(&conf);
+    return true;
+}
+
+auto Mux::remove(Conference& conf) -> void {
+    std::erase(conferences, &conf);
+    std::erase_if(rooms, [&conf](const auto& pair) { return pair.second == &conf; });
+    std::erase_if(prefixes, [&conf](const auto& pair) { return pair.second == &conf; });
+}
+
+auto Mux::route(const xmlview::Node& stanza) -> Conference* {
+    // results carry our own id back
+    if(stanza.name == "iq" && (stanza.is_attr_equal("type", "result") || stanza.is_attr_equal("type", "error"))) {
+        const auto id = stanza.find_attr("id");
+        if(id) {
+            const auto sep = id->find(prefix_separator);
+            if(sep != std::string_view::npos) {
+                if(const auto i = prefixes.find(id->substr(0, sep + 1)); i != prefixes.end()) {
+                    return i->second;
+                }
+            }
+        }
+    }
+    if(const auto from = stanza.find_attr("from"); from) {
+        if(const auto i = rooms.find(to_bare(*from)); i != rooms.end()) {
+            return i->second;
+        }
+    }
+    // e.g. disco queries from server components, the reply does not depend on the room
+    if(stanza.name == "iq" && !conferences.empty()) {
+        return conferences.front();
+    }
+    return nullptr;
+}
+
+auto Mux::feed_payload(const std::string_view payload) -> bool {
+    unwrap(stanza, doc.parse(payload), "xml parse error");
+    // any frame proves the shared connection alive
+    keepalive.on_received(std::chrono::steady_clock::now());
+    // count before routing, so that dropped stanzas are acknowledged as well
+    if(stream_manager != nullptr) {
+        stream_manager->count_received(stanza);
+        auto reply = std::string();
+        if(stream_manager->handle_nonza(stanza, reply)) {
+            if(!reply.empty() && !conferences.empty()) {
+                conferences.front()->send(reply, outbound::Priority::High);
+            }
+            return true;
+        }
+    }
+    unwrap(conf, route(stanza), "no conference for stanza {}", stanza.name);
+    ensure(!conf.dispatch_stanza(stanza), "conference in {} has finished", conf.config.room);
+    return true;
+}
+
+auto Mux::poll_keepalive() -> std::optional<std::chrono::steady_clock::time_point> {
+    const auto now = std::chrono::steady_clock::now();
+    for(const auto conf : conferences) {
+        conf->iqs.expire(now);
+    }
+    const auto sender = conferences.empty() ? nullptr : conferences.front();
+    switch(keepalive.poll(now)) {
+    case Keepalive::Action::Wait:
+        break;
+    case Keepalive::Action::Ping:
+        if(sender != nullptr) {
+            sender->send_ping([this, now](const bool success) -> void {
+                if(success) {
+                    keepalive.on_pong(std::chrono::steady_clock::now() - now);
+                }
+            });
+        }
+        break;
+    case Keepalive::Action::Dead:
+        LOG_ERROR(logger, "nothing received for {}ms after {} pings, connection is dead",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(now - keepalive.last_received).count(), keepalive.probes);
+        return std::nullopt;
+    }
+    if(sender != nullptr && stream_manager != nullptr && stream_manager->should_request_ack()) {
+        sender->send(stream_manager->build_request(), outbound::Priority::Normal);
+    }
+    auto next = keepalive.get_next_wakeup();
+    for(const auto conf : conferences) {
+        if(const auto deadline = conf->iqs.get_next_deadline(); deadline) {
+            next = std::min(next, *deadline);
+        }
+    }
+    return next;
+}
+} // namespace conference
@@ -0,0 +1,35 @@
+#pragma once
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "conference.hpp"
+#include "util/string-map.hpp"
+#include "xml-view.hpp"
+
+namespace conference {
+// shares one negotiated xmpp connection between conferences in different rooms
+// inbound stanzas are routed by the iq id prefix for iq results, and by the bare from jid otherwise
+// every conference must be added before its start_negotiation
+struct Mux {
+    xmlview::Document        doc;
+    std::vector<Conference*> conferences;
+    StringMap<Conference*>   rooms;    // keyed by bare muc jid
+    StringMap<Conference*>   prefixes; // keyed by iq id prefix
+    int                      serial         = 0;
+    xmpp::StreamManager*     stream_manager = nullptr; // the connection's, counts every stanza here instead of in the conferences
+    Keepalive                keepalive;                // the connection's, the ones of the conferences are not used
+
+    // returns false if another conference is already in the same room
+    auto add(Conference& conf) -> bool;
+    auto remove(Conference& conf) -> void;
+    // returns nullptr if no conference takes the stanza
+    auto route(const xmlview::Node& stanza) -> Conference*;
+    // parses the frame once and passes it to the conference it belongs to
+    // returns false if the frame was not delivered, or the conference has finished
+    auto feed_payload(std::string_view payload) -> bool;
+    // Conference::poll_keepalive for the shared connection
+    // expires timed out iqs of every conference, pings and requests acks through the first one
+    auto poll_keepalive() -> std::optional<std::chrono::steady_clock::time_point>;
+};
+} // namespace conference
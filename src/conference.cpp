@@ -8,7 +8,9 @@
 #include "util/pair-table.hpp"
 #include "util/span.hpp"
 #include "util/split.hpp"
+#include "xml-escape.hpp"
 #include "xmpp/elements.hpp"
+#include "xmpp/stanza-template.hpp"
 #include "json/json.hpp"
 
 #define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
@@ -18,41 +20,6 @@ namespace conference {
 namespace {
 auto logger = Logger("conference");
 
-auto replace(std::string str, const std::string_view from, const std::string_view to) -> std::string {
-    auto pos = 0uz;
-
-loop:
-    pos = str.find(from, pos);
-    if(pos == std::string::npos) {
-        return str;
-    }
-    str.replace(pos, from.size(), to);
-    pos += to.size();
-    goto loop;
-}
-
-const auto xml_escape_table = std::array{
-    std::pair("&", "&amp;"),
-    std::pair("<", "&lt;"),
-    std::pair(">", "&gt;"),
-    std::pair("\"", "&quot;"),
-    std::pair("'", "&apos;"),
-};
-
-[[maybe_unused]] auto xml_escape(std::string str) -> std::string {
-    for(auto i = xml_escape_table.begin(); i < xml_escape_table.end(); i += 1) {
-        str = replace(str, i->first, i->second);
-    }
-    return str;
-}
-
-auto xml_unescape(std::string str) -> std::string {
-    for(auto i = xml_escape_table.rbegin(); i < xml_escape_table.rend(); i += 1) {
-        str = replace(str, i->second, i->first);
-    }
-    return str;
-}
-
 constexpr auto disco_node = "https://github.com/mojyack/libjitsimeet";
 const auto     disco_info = xmpp::elm::query.clone()
                             .append_children({
@@ -101,6 +68,60 @@ const auto     disco_info = xmpp::elm::query.clone()
                                     }),
                             });
 
+// serialized once per process
+struct Templates {
+    xmpp::StanzaTemplate iq_result;         // from, to, id
+    xmpp::StanzaTemplate disco_result;      // from, to, id
+    xmpp::StanzaTemplate disco_node_result; // from, to, id, node
+    xmpp::StanzaTemplate ping;              // id
+    std::string          disco_sha1_base64;
+    std::string          disco_sha256_base64;
+};
+
+auto build_templates() -> std::optional<Templates> {
+    const auto iq_result = xmpp::elm::iq.clone()
+                               .append_attrs({
+                                   {"from", xmpp::slot_marker(0)},
+                                   {"to", xmpp::slot_marker(1)},
+                                   {"id", xmpp::slot_marker(2)},
+                                   {"type", "result"},
+                               });
+    unwrap_mut(iq_result_tmpl, xmpp::StanzaTemplate::create(iq_result));
+    unwrap_mut(disco_result_tmpl, xmpp::StanzaTemplate::create(iq_result.clone().append_children({disco_info})));
+    unwrap_mut(disco_node_result_tmpl, xmpp::StanzaTemplate::create(iq_result.clone().append_children({
+        disco_info.clone()
+            .append_attrs({
+                {"node", xmpp::slot_marker(3)},
+            }),
+    })));
+    unwrap_mut(ping_tmpl, xmpp::StanzaTemplate::create(xmpp::elm::iq.clone()
+                                                           .append_attrs({
+                                                               {"type", "get"},
+                                                               {"id", xmpp::slot_marker(0)},
+                                                           })
+                                                           .append_children({
+                                                               xmpp::elm::ping,
+                                                           })));
+
+    unwrap(disco_str, compute_disco_str(disco_info));
+    unwrap(disco_sha1, crypto::sha::calc_sha1(to_span(disco_str)));
+    unwrap(disco_sha256, crypto::sha::calc_sha256(to_span(disco_str)));
+    return Templates{
+        .iq_result           = std::move(iq_result_tmpl),
+        .disco_result        = std::move(disco_result_tmpl),
+        .disco_node_result   = std::move(disco_node_result_tmpl),
+        .ping                = std::move(ping_tmpl),
+        .disco_sha1_base64   = crypto::base64::encode(disco_sha1),
+        .disco_sha256_base64 = crypto::base64::encode(disco_sha256),
+    };
+}
+
+// returns nullptr if building failed, checked in Conference::create
+auto get_templates() -> const Templates* {
+    static const auto templates = build_templates();
+    return templates ? &*templates : nullptr;
+}
+
 const auto codec_type_str = make_pair_table<CodecType, std::string_view>({
     // {CodecType::Opus, "opus"},
     {CodecType::H264, "h264"},
@@ -117,40 +138,108 @@ auto jid_node_to_muc_resource(const std::string_view node) -> std::string {
     return std::string(node);
 }
 
-auto handle_iq_get(Conference* const conf, const xml::Node& iq) -> bool {
-    unwrap(from, iq.find_attr("from"));
-    unwrap(id, iq.find_attr("id"));
+auto emit_participant_event(Conference* const          conf,
+                            const ParticipantEventType type,
+                            const ParticipantHandle    handle,
+                            const bool                 is_audio  = false,
+                            const bool                 new_muted = false) -> void {
+    if(conf->config.participant_event_delivery == ParticipantEventDelivery::Immediate) {
+        const auto participant = conf->participants.get(handle);
+        switch(type) {
+        case ParticipantEventType::Joined:
+            conf->callbacks->on_participant_joined(participant);
+            break;
+        case ParticipantEventType::Left:
+            conf->callbacks->on_participant_left(participant);
+            break;
+        case ParticipantEventType::MuteChanged:
+            conf->callbacks->on_mute_state_changed(participant, is_audio, new_muted);
+            break;
+        }
+        return;
+    }
+    if(conf->pending_participant_events.empty()) {
+        conf->pending_participant_events_since = std::chrono::steady_clock::now();
+    }
+    // the mute flags are taken now like Immediate delivery sees them, id and nick are filled on flush
+    // the handle must not be recycled before that
+    const auto participant = conf->participants.get(handle);
+    conf->participants.retain(handle);
+    conf->pending_participant_events.push_back(ParticipantEvent{
+        .type        = type,
+        .participant = {.handle = handle, .audio_muted = participant.audio_muted, .video_muted = participant.video_muted},
+        .is_audio    = is_audio,
+        .new_muted   = new_muted,
+    });
+}
+
+// the room reflects our own join presence with status code 110, xep-0045 7.2.2
+auto is_self_presence(const Conference& conf, const std::string_view from, const xmlview::Node& presence) -> bool {
+    for(const auto& payload : presence.children()) {
+        if(payload.name != "x" || !payload.is_attr_equal("xmlns", xmpp::ns::muc_user)) {
+            continue;
+        }
+        for(const auto& status : payload.children()) {
+            if(status.name == "status" && status.is_attr_equal("code", "110")) {
+                return true;
+            }
+        }
+    }
+    // in case the status code is omitted
+    return from == conf.config.get_muc_local_jid().as_full();
+}
+
+// digest of the presence children handle_presence() cares about
+auto compute_presence_digest(const xmlview::Node& presence) -> uint64_t {
+    // fnv-1a
+    auto       digest = uint64_t(0xcbf29ce484222325);
+    const auto feed   = [&digest](const std::string_view str) {
+        for(const auto c : str) {
+            digest ^= uint8_t(c);
+            digest *= 0x100000001b3;
+        }
+        digest ^= 0xff; // separator
+        digest *= 0x100000001b3;
+    };
+    for(const auto& payload : presence.children()) {
+        if(payload.name == xmpp::elm::nick.name || payload.name == "audiomuted" || payload.name == "videomuted" || payload.name == "SourceInfo") {
+            feed(payload.name);
+            feed(payload.data);
+        }
+    }
+    return digest;
+}
+
+// equivalent to source_name == participant_id + suffix
+auto is_source_of(const std::string_view source_name, const std::string_view participant_id, const std::string_view suffix) -> bool {
+    return source_name.size() == participant_id.size() + suffix.size() &&
+           source_name.starts_with(participant_id) &&
+           source_name.ends_with(suffix);
+}
+
+auto handle_iq_get(Conference* const conf, const xmlview::Node& iq) -> bool {
+    unwrap(from_raw, iq.find_attr("from"));
+    unwrap(id_raw, iq.find_attr("id"));
     unwrap(query, iq.find_first_child("query"));
-    auto iqr = xmpp::elm::iq.clone()
-                   .append_attrs({
-                       {"from", conf->config.jid.as_full()},
-                       {"to", std::string(from)},
-                       {"id", std::string(id)},
-                       {"type", "result"},
-                   });
-    const auto node = query.find_attr("node");
-    if(node) {
+    auto       from_buf  = std::string();
+    auto       id_buf    = std::string();
+    const auto from      = escape::xml_unescape(from_raw, from_buf);
+    const auto id        = escape::xml_unescape(id_raw, id_buf);
+    const auto templates = get_templates();
+    if(const auto node = query.find_attr("node"); node) {
         const auto sep = node->rfind("#");
         ensure(sep != std::string::npos);
         const auto uri  = node->substr(0, sep);
         const auto hash = node->substr(sep + 1);
         ensure(uri == disco_node && hash == conf->disco_sha1_base64);
-        iqr.append_children({
-            disco_info.clone()
-                .append_attrs({
-                    {"node", std::string(*node)},
-                }),
-        });
+        conf->send(templates->disco_node_result.fill(conf->send_buf, {conf->full_jid, from, id, *node}), outbound::Priority::High);
     } else {
-        iqr.append_children({
-            disco_info,
-        });
+        conf->send(templates->disco_result.fill(conf->send_buf, {conf->full_jid, from, id}), outbound::Priority::High);
     }
-    conf->callbacks->send_payload(xml::deparse(iqr));
     return true;
 }
 
-auto handle_iq_set(Conference* const conf, const xml::Node& iq) -> bool {
+auto handle_iq_set(Conference* const conf, const xmlview::Node& iq) -> bool {
     unwrap(from, iq.find_attr("from"));
     unwrap(from_jid, xmpp::Jid::parse(from));
     if(from_jid.resource != "focus") {
@@ -162,41 +251,32 @@ auto handle_iq_set(Conference* const conf, const xml::Node& iq) -> bool {
     unwrap_mut(jingle, jingle::parse(jingle_node));
 
     LOG_DEBUG(logger, "jingle action {}", std::to_underlying(jingle.action));
+    if(jingle.action == jingle::Action::SessionInitiate) {
+        trace::end(conf->config.join_trace, trace::Phase::SessionInitiate);
+    }
     if(!conf->callbacks->on_jingle(std::move(jingle))) {
         LOG_WARN(logger, "failed to process jingle action={}", std::to_underlying(jingle.action));
         return true;
     }
 
-    const auto iqr = xmpp::elm::iq.clone()
-                         .append_attrs({
-                             {"from", conf->config.jid.as_full()},
-                             {"to", std::string(from)},
-                             {"id", std::string(id)},
-                             {"type", "result"},
-                         });
-    conf->callbacks->send_payload(xml::deparse(iqr));
+    auto       from_buf = std::string();
+    auto       id_buf   = std::string();
+    const auto to       = escape::xml_unescape(from, from_buf);
+    const auto id_str   = escape::xml_unescape(id, id_buf);
+    conf->send(get_templates()->iq_result.fill(conf->send_buf, {conf->full_jid, to, id_str}), outbound::Priority::High);
     return true;
 }
 
-auto handle_iq_result(Conference* const conf, const xml::Node& iq, bool success) -> bool {
+auto handle_iq_result(Conference* const conf, const xmlview::Node& iq, bool success) -> bool {
     unwrap(id, iq.find_attr("id"));
-    for(auto i = conf->sent_iqs.begin(); i != conf->sent_iqs.end(); i += 1) {
-        if(i->id != id) {
-            continue;
-        }
-        if(!success) {
-            LOG_ERROR(logger, "iq {} failed", id);
-        }
-        if(i->on_result) {
-            i->on_result(success);
-        }
-        conf->sent_iqs.erase(i);
-        return true;
+    if(!success) {
+        LOG_ERROR(logger, "iq {} failed", id);
     }
-    bail("stray iq result");
+    ensure(conf->iqs.resolve(id, success), "stray iq result");
+    return true;
 }
 
-auto handle_iq(Conference* const conf, const xml::Node& iq) -> bool {
+auto handle_iq(Conference* const conf, const xmlview::Node& iq) -> bool {
     unwrap(type, iq.find_attr("type"));
     if(type == "get") {
         return handle_iq_get(conf, iq);
@@ -211,17 +291,22 @@ auto handle_iq(Conference* const conf, const xml::Node& iq) -> bool {
     }
 }
 
-auto handle_presence(Conference* const conf, const xml::Node& presence) -> bool {
-    const auto response = xml::parse(conf->worker_arg).value();
-
+auto handle_presence(Conference* const conf, const xmlview::Node& presence) -> bool {
     unwrap(from_str, presence.find_attr("from"));
     unwrap(from, xmpp::Jid::parse(from_str));
+    ensure(!from.resource.empty(), "presence from bare jid {}", from_str);
+    const auto& resource = from.resource;
     LOG_DEBUG(logger, "got presence from {}", from_str);
+    if(conf->config.join_trace != nullptr && is_self_presence(*conf, from_str, presence)) {
+        conf->config.join_trace->end(trace::Phase::Presence);
+    }
+
+    auto& participants = conf->participants;
     if(const auto type = presence.find_attr("type"); type) {
         if(*type == "unavailable") {
-            if(const auto i = conf->participants.find(from.resource); i != conf->participants.end()) {
-                conf->callbacks->on_participant_left(i->second);
-                conf->participants.erase(i);
+            if(const auto handle = participants.find(resource); handle != invalid_participant_handle && participants.is_present(handle)) {
+                emit_participant_event(conf, ParticipantEventType::Left, handle);
+                participants.set_left(handle);
             } else {
                 LOG_WARN(logger, "got unavailable presence from unknown participant");
             }
@@ -229,21 +314,17 @@ auto handle_presence(Conference* const conf, const xml::Node& presence) -> bool
         return true;
     }
 
-    auto participant = (Participant*)(nullptr);
-    auto joined      = false;
-    if(const auto i = conf->participants.find(from.resource); i == conf->participants.end()) {
-        const auto& p = conf->participants.insert({from.resource,
-                                                   Participant{
-                                                       .participant_id = from.resource,
-                                                       .nick           = "",
-                                                       .audio_muted    = true,
-                                                       .video_muted    = true,
-                                                   }});
-        participant   = &p.first->second;
-        joined        = true;
-    } else {
-        participant = &i->second;
+    const auto digest = compute_presence_digest(presence);
+    const auto handle = participants.intern(resource);
+    const auto joined = !participants.is_present(handle);
+    auto&      entry  = participants.entries[handle];
+    if(joined) {
+        participants.set_joined(handle);
+    } else if(entry.presence_digest == digest) {
+        conf->presence_stats.skipped += 1;
+        return true;
     }
+    conf->presence_stats.processed += 1;
 
     auto audio_muted = std::optional<bool>();
     auto video_muted = std::optional<bool>();
@@ -253,9 +334,9 @@ auto handle_presence(Conference* const conf, const xml::Node& presence) -> bool
     // libjitsimeet only uses "{video,audio}muted" in its presence.
     // so we have to handle both.
 
-    for(const auto& payload : presence.children) {
+    for(const auto& payload : presence.children()) {
         if(payload.name == xmpp::elm::nick.name && payload.is_attr_equal("xmlns", xmpp::ns::nick)) {
-            participant->nick = payload.data;
+            entry.nick = payload.get_data();
         } else if(payload.name == "audiomuted" || payload.name == "videomuted") {
             auto muted = bool();
             if(payload.data == "true") {
@@ -267,7 +348,7 @@ auto handle_presence(Conference* const conf, const xml::Node& presence) -> bool
             }
             (payload.name == "audiomuted" ? audio_muted : video_muted).emplace(muted);
         } else if(payload.name == "SourceInfo") {
-            unwrap(info, json::parse(xml_unescape(payload.data)), "failed to parse SourceInfo");
+            unwrap(info, json::parse(payload.get_data()), "failed to parse SourceInfo");
             for(auto i = info.children.begin(); i != info.children.end(); i = std::next(i)) {
                 const auto& [key, value] = *i;
                 const auto object        = value.get<json::Object>();
@@ -283,9 +364,9 @@ auto handle_presence(Conference* const conf, const xml::Node& presence) -> bool
                     continue;
                 }
                 const auto& source_name = key;
-                if(source_name == participant->participant_id + "-a0") {
+                if(is_source_of(source_name, entry.id, "-a0")) {
                     audio_muted.emplace(v->value);
-                } else if(source_name == participant->participant_id + "-v0") {
+                } else if(is_source_of(source_name, entry.id, "-v0")) {
                     video_muted.emplace(v->value);
                 } else {
                     LOG_WARN(logger, "unsupported source name format: {}", source_name);
@@ -295,21 +376,24 @@ auto handle_presence(Conference* const conf, const xml::Node& presence) -> bool
         }
     }
 
+    // only after the payloads are parsed, a presence which failed must not be skipped next time
+    entry.presence_digest = digest;
+
     if(joined) {
-        conf->callbacks->on_participant_joined(*participant);
+        emit_participant_event(conf, ParticipantEventType::Joined, handle);
     }
     if(audio_muted.has_value()) {
         const auto muted = *audio_muted;
-        if(participant->audio_muted != muted) {
-            conf->callbacks->on_mute_state_changed(*participant, true, muted);
-            participant->audio_muted = muted;
+        if(participants.is_muted(handle, true) != muted) {
+            emit_participant_event(conf, ParticipantEventType::MuteChanged, handle, true, muted);
+            participants.set_muted(handle, true, muted);
         }
     }
     if(video_muted.has_value()) {
         const auto muted = *video_muted;
-        if(participant->video_muted != muted) {
-            conf->callbacks->on_mute_state_changed(*participant, false, muted);
-            participant->video_muted = muted;
+        if(participants.is_muted(handle, false) != muted) {
+            emit_participant_event(conf, ParticipantEventType::MuteChanged, handle, false, muted);
+            participants.set_muted(handle, false, muted);
         }
     }
 
@@ -321,6 +405,7 @@ auto handle_received(Conference* const conf) -> Conference::Worker::Generator {
 
     // disco
     {
+        trace::begin(conf->config.join_trace, trace::Phase::FocusConference);
         const auto id   = conf->generate_iq_id();
         const auto muid = std::format("muid_{}", rng::generate_random_uint32());
         const auto iq   = xmpp::elm::iq.clone()
@@ -346,16 +431,23 @@ auto handle_received(Conference* const conf) -> Conference::Worker::Generator {
                                             }),
                                     }),
                             });
-        conf->callbacks->send_payload(xml::deparse(iq));
+        conf->send(xml::deparse(iq), outbound::Priority::Normal);
         co_yield true;
 
-        const auto response = xml::parse(conf->worker_arg).value();
-        co_ensure_v(response.name == "iq", "unexpected response");
-        co_ensure_v(response.is_attr_equal("id", id), "unexpected iq");
+        // the request may be pipelined with others on the connection, handle whatever arrives before the response
+        while(!(conf->worker_arg->name == "iq" && conf->worker_arg->is_attr_equal("id", id))) {
+            const auto& stanza = *conf->worker_arg;
+            if(const auto i = conf->stanza_handlers.find(stanza.name); i != conf->stanza_handlers.end()) {
+                co_ensure_v(i->second(conf, stanza));
+            }
+            co_yield true;
+        }
+        const auto& response = *conf->worker_arg;
         co_ensure_v(response.is_attr_equal("type", "result"), "unexpected iq");
         const auto conference = response.find_first_child("conference");
         co_ensure_v(conference != nullptr);
         co_ensure_v(conference->is_attr_equal("ready", "true"), "conference not ready");
+        trace::end(conf->config.join_trace, trace::Phase::FocusConference);
     }
     // presence
     {
@@ -406,28 +498,23 @@ auto handle_received(Conference* const conf) -> Conference::Worker::Generator {
                         .set_data(conf->config.nick),
                 });
 
-        conf->callbacks->send_payload(xml::deparse(presence));
+        conf->send(xml::deparse(presence), outbound::Priority::Low);
+        trace::begin(conf->config.join_trace, trace::Phase::Presence);
+        trace::begin(conf->config.join_trace, trace::Phase::SessionInitiate);
         co_yield true;
     }
 
     // idle
 loop:
     auto yield = false;
-    do {
-        const auto response_r = xml::parse(conf->worker_arg);
-        if(!response_r) {
-            LOG_ERROR(logger, "xml parse error");
-            break;
-        }
-        const auto& response = response_r.value();
-        if(response.name == "iq") {
-            yield = handle_iq(conf, response);
-        } else if(response.name == "presence") {
-            yield = handle_presence(conf, response);
+    {
+        const auto& response = *conf->worker_arg;
+        if(const auto i = conf->stanza_handlers.find(response.name); i != conf->stanza_handlers.end()) {
+            yield = i->second(conf, response);
         } else {
             LOG_WARN(logger, "not implemented xmpp message {}", response.name);
         }
-    } while(0);
+    }
     co_yield yield;
     goto loop;
 }
@@ -462,7 +549,7 @@ auto Config::get_muc_local_focus_jid() const -> xmpp::Jid {
 }
 
 auto Conference::generate_iq_id() -> std::string {
-    return std::format("iq_{}", (iq_serial += 1));
+    return std::format("{}iq_{}", iq_id_prefix, iq_serial.fetch_add(1, std::memory_order_relaxed) + 1);
 }
 
 auto Conference::start_negotiation() -> void {
@@ -471,32 +558,143 @@ auto Conference::start_negotiation() -> void {
 }
 
 auto Conference::feed_payload(const std::string_view payload) -> bool {
-    worker_arg = payload;
+    const auto stanza = worker_doc.parse(payload);
+    if(stanza == nullptr) {
+        LOG_ERROR(logger, "xml parse error");
+        return worker.done();
+    }
+    keepalive.on_received(std::chrono::steady_clock::now());
+    return feed_stanza(*stanza);
+}
+
+auto Conference::feed_stanza(const xmlview::Node& stanza) -> bool {
+    if(config.stream_manager != nullptr) {
+        auto reply = std::string();
+        if(config.stream_manager->on_received(stanza, reply)) {
+            if(!reply.empty()) {
+                send(reply, outbound::Priority::High);
+            }
+            return worker.done();
+        }
+    }
+    return dispatch_stanza(stanza);
+}
+
+auto Conference::dispatch_stanza(const xmlview::Node& stanza) -> bool {
+    const auto now = std::chrono::steady_clock::now();
+    iqs.expire(now);
+    worker_arg = &stanza;
     worker.resume();
+    worker_arg = nullptr;
+
+    switch(config.participant_event_delivery) {
+    case ParticipantEventDelivery::Immediate:
+        break;
+    case ParticipantEventDelivery::PerFrame:
+        flush_participant_events();
+        break;
+    case ParticipantEventDelivery::Windowed:
+        if(now - pending_participant_events_since >= config.participant_event_window) {
+            flush_participant_events();
+        }
+        break;
+    }
     return worker.done();
 }
 
-auto Conference::send_iq(xml::Node node, std::function<void(bool)> on_result) -> void {
-    const auto id = generate_iq_id();
+auto Conference::send(const std::string_view payload, const outbound::Priority priority) -> void {
+    if(config.outbound_queue != nullptr) {
+        config.outbound_queue->push(std::string(payload), priority);
+    } else {
+        callbacks->send_payload(payload);
+        // with a queue, on_sent is called when the payload leaves the queue so that the count follows the wire order
+        if(config.stream_manager != nullptr) {
+            config.stream_manager->on_sent(payload);
+        }
+    }
+}
+
+auto Conference::send_iq(xml::Node node, IqCallback on_result, const outbound::Priority priority) -> void {
+    const auto id   = generate_iq_id();
+    const auto kind = node.children.empty() ? std::string_view() : std::string_view(node.children[0].name);
     node.append_attrs({{"id", id}});
-    sent_iqs.push_back(SentIq{
-        .id        = id,
-        .on_result = on_result,
-    });
-    callbacks->send_payload(xml::deparse(node));
+    iqs.add(id, kind, std::move(on_result));
+    send(xml::deparse(node), priority);
+}
+
+auto Conference::send_ping(IqCallback on_result) -> void {
+    const auto id = generate_iq_id();
+    iqs.add(id, "ping", std::move(on_result));
+    send(get_templates()->ping.fill(send_buf, {id}), outbound::Priority::Normal);
+}
+
+auto Conference::poll_keepalive() -> std::optional<std::chrono::steady_clock::time_point> {
+    const auto now = std::chrono::steady_clock::now();
+    iqs.expire(now);
+    switch(keepalive.poll(now)) {
+    case Keepalive::Action::Wait:
+        break;
+    case Keepalive::Action::Ping:
+        send_ping([this, now](const bool success) -> void {
+            if(success) {
+                keepalive.on_pong(std::chrono::steady_clock::now() - now);
+            }
+        });
+        break;
+    case Keepalive::Action::Dead:
+        LOG_ERROR(logger, "nothing received for {}ms after {} pings, connection is dead",
+                  std::chrono::duration_cast<std::chrono::milliseconds>(now - keepalive.last_received).count(), keepalive.probes);
+        return std::nullopt;
+    }
+    if(config.stream_manager != nullptr && config.stream_manager->should_request_ack()) {
+        send(config.stream_manager->build_request(), outbound::Priority::Normal);
+    }
+    auto next = keepalive.get_next_wakeup();
+    if(const auto deadline = iqs.get_next_deadline(); deadline) {
+        next = std::min(next, *deadline);
+    }
+    return next;
+}
+
+auto Conference::add_stanza_handler(const std::string_view name, StanzaHandler handler) -> void {
+    stanza_handlers.insert_or_assign(std::string(name), std::move(handler));
+}
+
+auto Conference::flush_participant_events() -> void {
+    if(pending_participant_events.empty()) {
+        return;
+    }
+    // callbacks may feed more payloads, swap first to keep the batch intact
+    auto events = std::exchange(pending_participant_events, {});
+    for(auto& event : events) {
+        const auto participant           = participants.get(event.participant.handle);
+        event.participant.participant_id = participant.participant_id;
+        event.participant.nick           = participant.nick;
+    }
+    callbacks->on_participants_changed(events);
+    for(const auto& event : events) {
+        participants.release(event.participant.handle);
+    }
+    events.clear();
+    if(pending_participant_events.empty()) {
+        pending_participant_events = std::move(events); // recycle the capacity
+    }
 }
 
 auto Conference::create(Config config, ConferenceCallbacks* const callbacks) -> std::unique_ptr<Conference> {
+    unwrap(templates, get_templates(), "failed to build stanza templates");
     auto conf = new Conference{
-        .config    = std::move(config),
-        .callbacks = callbacks,
+        .config              = std::move(config),
+        .disco_sha1_base64   = templates.disco_sha1_base64,
+        .disco_sha256_base64 = templates.disco_sha256_base64,
+        .callbacks           = callbacks,
     };
-
-    unwrap(disco_str, compute_disco_str(disco_info));
-    unwrap(disco_sha1, crypto::sha::calc_sha1(to_span(disco_str)));
-    unwrap(disco_sha256, crypto::sha::calc_sha256(to_span(disco_str)));
-    conf->disco_sha1_base64   = crypto::base64::encode(disco_sha1);
-    conf->disco_sha256_base64 = crypto::base64::encode(disco_sha256);
+    conf->full_jid                = conf->config.jid.as_full();
+    conf->iqs.timeout             = conf->config.iq_timeout;
+    conf->keepalive.config        = conf->config.keepalive;
+    conf->keepalive.last_received = std::chrono::steady_clock::now();
+    conf->add_stanza_handler("iq", handle_iq);
+    conf->add_stanza_handler("presence", handle_presence);
 
     return std::unique_ptr<Conference>(conf);
 }
@@ -1,20 +1,41 @@
 #pragma once
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <span>
 
 #include "codec-type.hpp"
+#include "iq-tracker.hpp"
 #include "jingle/jingle.hpp"
+#include "join-trace.hpp"
+#include "keepalive.hpp"
+#include "outbound-queue.hpp"
+#include "participant-registry.hpp"
 #include "util/coroutine.hpp"
 #include "util/string-map.hpp"
+#include "xml-view.hpp"
 #include "xml/xml.hpp"
 #include "xmpp/jid.hpp"
+#include "xmpp/stream-manager.hpp"
 
 namespace conference {
-struct Participant {
-    std::string participant_id;
-    std::string nick;
-    bool        audio_muted;
-    bool        video_muted;
+enum class ParticipantEventType {
+    Joined,
+    Left,
+    MuteChanged,
+};
+
+struct ParticipantEvent {
+    ParticipantEventType type;
+    Participant          participant; // mute flags before the event, id and nick at delivery time. use handle to tell participants apart
+    bool                 is_audio;    // MuteChanged only
+    bool                 new_muted;   // MuteChanged only
+};
+
+enum class ParticipantEventDelivery {
+    Immediate, // one on_participant_joined/left/on_mute_state_changed call per event
+    PerFrame,  // one on_participants_changed call per received frame
+    Windowed,  // on_participants_changed once the oldest pending event is older than Config::participant_event_window
 };
 
 struct ConferenceCallbacks {
@@ -33,14 +54,28 @@ struct ConferenceCallbacks {
     virtual auto on_mute_state_changed(const Participant& /*participant*/, bool /*is_audio*/, bool /*new_muted*/) -> void {
     }
 
+    // used instead of the three callbacks above unless delivery mode is Immediate
+    // events are in the order the stanzas arrived. within one presence, Joined comes first,
+    // then audio and video MuteChanged. a Left event is always the last event of that participant instance
+    // the mute flags in each event are what the Immediate callbacks would see, new_muted is not applied to them yet
+    virtual auto on_participants_changed(std::span<const ParticipantEvent> /*events*/) -> void {
+    }
+
     virtual ~ConferenceCallbacks() {};
 };
 
-struct SentIq {
-    std::string               id;
-    std::function<void(bool)> on_result; // optional
+struct PresenceStats {
+    uint64_t processed = 0;
+    uint64_t skipped   = 0; // identical to the last presence of the participant
 };
 
+struct Conference;
+
+// handles one already parsed top level stanza
+// returns false on fatal error
+// the stanza refers to the received payload and must not be kept after returning
+using StanzaHandler = std::function<bool(Conference* conf, const xmlview::Node& stanza)>;
+
 struct Config {
     xmpp::Jid   jid;
     std::string room;
@@ -49,6 +84,21 @@ struct Config {
     bool        audio_muted;
     bool        video_muted;
 
+    // sent iqs not answered within this time fail with on_result(false)
+    std::chrono::milliseconds iq_timeout = std::chrono::seconds(30);
+
+    ParticipantEventDelivery  participant_event_delivery = ParticipantEventDelivery::Immediate;
+    std::chrono::milliseconds participant_event_window   = std::chrono::milliseconds(100);
+
+    KeepaliveConfig keepalive;
+
+    // when set, stanzas are pushed here with their priority instead of being passed to send_payload
+    outbound::Queue*     outbound_queue = nullptr;
+    // the one given to the negotiator, if any
+    xmpp::StreamManager* stream_manager = nullptr;
+    // optional, records the focus request and presence phases
+    trace::JoinTrace* join_trace = nullptr;
+
     auto get_focus_jid() const -> xmpp::Jid;
     auto get_muc_jid() const -> xmpp::Jid;
     auto get_muc_local_jid() const -> xmpp::Jid;
@@ -63,20 +113,51 @@ struct Conference {
     std::string          disco_sha1_base64;
     std::string          disco_sha256_base64;
     ConferenceCallbacks* callbacks;
+    std::string          full_jid;     // config.jid.as_full()
+    std::string          iq_id_prefix; // prepended to every iq id, assigned by Mux
 
     // coroutine
-    std::string_view worker_arg;
-    Worker           worker;
+    xmlview::Document    worker_doc;
+    const xmlview::Node* worker_arg;
+    Worker               worker;
 
     // state
-    std::vector<SentIq>    sent_iqs;
-    StringMap<Participant> participants;
-    static inline int      iq_serial;
+    IqTracker                iqs;       // also holds round trip statistics per iq kind
+    Keepalive                keepalive; // srtt and jitter of pings are available here
+    ParticipantRegistry      participants;
+    StringMap<StanzaHandler> stanza_handlers; // keyed by stanza name
+    PresenceStats            presence_stats;
+    std::string              send_buf; // reused to build outgoing stanzas from templates
+
+    // batched participant events
+    std::vector<ParticipantEvent>         pending_participant_events;
+    std::chrono::steady_clock::time_point pending_participant_events_since;
+
+    static inline std::atomic_int iq_serial; // shared by every conference in the process
 
     auto generate_iq_id() -> std::string;
     auto start_negotiation() -> void;
     auto feed_payload(std::string_view payload) -> bool;
-    auto send_iq(xml::Node iq, std::function<void(bool)> on_result) -> void;
+    // same as feed_payload, for callers which already parsed the frame
+    // stanza has to stay valid during the call only
+    auto feed_stanza(const xmlview::Node& stanza) -> bool;
+    // same as feed_stanza, for callers which passed stanza to the stream manager themselves
+    auto dispatch_stanza(const xmlview::Node& stanza) -> bool;
+    // passes payload to outbound_queue or send_payload
+    auto send(std::string_view payload, outbound::Priority priority) -> void;
+    // on_result is optional
+    auto send_iq(xml::Node iq, IqCallback on_result, outbound::Priority priority = outbound::Priority::Normal) -> void;
+    auto send_ping(IqCallback on_result) -> void;
+    // expires timed out iqs and sends a keepalive ping if needed
+    // returns when to call this again, or nullopt if the connection is considered dead
+    // conferences in a Mux use Mux::poll_keepalive instead
+    auto poll_keepalive() -> std::optional<std::chrono::steady_clock::time_point>;
+    // registers a handler for stanzas named "name"
+    // "iq" and "presence" are registered by default, adding them again replaces the builtin handlers
+    auto add_stanza_handler(std::string_view name, StanzaHandler handler) -> void;
+    // delivers pending batched participant events now
+    // call this from a timer in Windowed mode, so that events arriving in a quiet period are not delayed indefinitely
+    auto flush_participant_events() -> void;
 
     static auto create(Config config, ConferenceCallbacks* callbacks) -> std::unique_ptr<Conference>;
 
@@ -9,6 +9,7 @@
 #include "async-websocket.hpp"
 #include "colibri.hpp"
 #include "conference.hpp"
+#include "jingle-handler/hostaddr.hpp"
 #include "jingle-handler/jingle.hpp"
 #include "macros/assert.hpp"
 #include "util/argument-parser.hpp"
@@ -19,27 +20,37 @@
 
 namespace {
 struct XMPPNegotiatorCallbacks : public xmpp::NegotiatorCallbacks {
-    ws::client::Context* ws_context;
+    ws::client::Context*                   ws_context;
+    std::function<void(const xmpp::Jid&)> on_bound_handler;
 
     virtual auto send_payload(std::string_view payload) -> void override {
         ensure(ws_context->send(payload));
     }
+
+    virtual auto on_bound(const xmpp::Jid& jid) -> void override {
+        on_bound_handler(jid);
+    }
 };
 
 struct ConferenceCallbacks : public conference::ConferenceCallbacks {
     ws::client::Context* ws_context;
-    JingleHandler*       jingle_handler;
+    JingleHandler*       jingle_handler = nullptr;
 
     virtual auto send_payload(std::string_view payload) -> void override {
         ensure(ws_context->send(payload));
     }
 
     virtual auto on_jingle(jingle::Jingle jingle) -> bool override {
+        ensure(jingle_handler != nullptr, "jingle arrived before the jid was bound");
         switch(jingle.action) {
         case jingle::Action::SessionInitiate:
             return jingle_handler->on_initiate(std::move(jingle));
         case jingle::Action::SourceAdd:
             return jingle_handler->on_add_source(std::move(jingle));
+        case jingle::Action::SourceRemove:
+            return jingle_handler->on_remove_source(std::move(jingle));
+        case jingle::Action::TransportInfo:
+            return jingle_handler->on_transport_info(std::move(jingle));
         case jingle::Action::SessionTerminate:
             ws_context->shutdown();
             return true;
@@ -61,20 +72,46 @@ struct ConferenceCallbacks : public conference::ConferenceCallbacks {
     }
 };
 
-auto pinger_main(conference::Conference& conference) -> coop::Async<void> {
-    static const auto iq = xmpp::elm::iq.clone()
-                               .append_attrs({
-                                   {"type", "get"},
-                               })
-                               .append_children({
-                                   xmpp::elm::ping,
-                               });
+auto keepalive_main(conference::Conference& conference, ws::client::Context& ws_context) -> coop::Async<void> {
 loop:
-    conference.send_iq(iq, {});
-    co_await coop::sleep(std::chrono::seconds(10));
+    const auto next = conference.poll_keepalive();
+    if(!next) {
+        std::println("connection lost");
+        ws_context.shutdown();
+        co_return;
+    }
+    co_await coop::sleep(std::chrono::duration_cast<std::chrono::milliseconds>(*next - std::chrono::steady_clock::now()));
     goto loop;
 }
 
+auto jingle_iq(const conference::Conference& conference, const jingle::Jingle& jingle) -> xml::Node {
+    return xmpp::elm::iq.clone()
+        .append_attrs({
+            {"from", conference.config.jid.as_full()},
+            {"to", conference.config.get_muc_local_focus_jid().as_full()},
+            {"type", "set"},
+        })
+        .append_children({
+            *jingle::deparse(jingle),
+        });
+}
+
+auto send_transport_info(conference::Conference& conference, JingleHandler& jingle_handler) -> coop::Async<void> {
+    const auto info = jingle_handler.build_transport_info();
+    if(!info) {
+        co_return;
+    }
+    conference.send_iq(jingle_iq(conference, *info), [](bool success) -> void {
+        dynamic_assert(success, "failed to send transport-info iq");
+    });
+    co_return;
+}
+
+auto warm_up_agents(ice::AgentPool& agent_pool) -> coop::Async<void> {
+    co_await hostaddr::Resolver::get().prefetch(agent_pool.external_services);
+    agent_pool.fill();
+}
+
 auto async_main(const int argc, const char* const argv[]) -> coop::Async<int> {
     constexpr auto error_value = -1;
 
@@ -97,6 +134,8 @@ auto async_main(const int argc, const char* const argv[]) -> coop::Async<int> {
     auto& runner     = *co_await coop::reveal_runner();
     auto  injector   = coop::TaskInjector(runner);
     auto  ws_context = ws::client::AsyncContext();
+    auto  join_trace = trace::JoinTrace();
+    join_trace.begin(trace::Phase::WebsocketConnect);
     co_ensure_v(ws_context.init(
         injector,
         {
@@ -106,21 +145,70 @@ auto async_main(const int argc, const char* const argv[]) -> coop::Async<int> {
             .port      = 443,
             .ssl_level = secure ? ws::client::SSLLevel::Enable : ws::client::SSLLevel::TrustSelfSigned,
         }));
+    join_trace.end(trace::Phase::WebsocketConnect);
 
     auto ws_task = coop::TaskHandle();
     runner.push_task(ws_context.process_until_finish(), &ws_task);
 
-    auto event  = coop::SingleEvent();
-    auto jid    = xmpp::Jid();
-    auto ext_sv = std::vector<xmpp::Service>();
+    constexpr auto audio_codec_type = CodecType::Opus;
+    constexpr auto video_codec_type = CodecType::H264;
+
+    // generated while negotiating
+    const auto cert_pool  = cert::Pool::create();
+    auto       agent_pool = std::unique_ptr<ice::AgentPool>();
 
-    // gain jid from server
+    auto event          = coop::SingleEvent();
+    auto initiated      = coop::SingleEvent();
+    auto ext_sv         = std::vector<xmpp::Service>();
+    auto stream_manager = xmpp::StreamManager();
+
+    auto outbound_queue           = outbound::Queue();
+    auto sender_task              = coop::TaskHandle();
+    outbound_queue.stream_manager = &stream_manager;
+    auto send = [&ws_context](const std::string_view payload) -> bool {
+        return ws_context.send(payload);
+    };
+    runner.push_task(outbound_queue.run_sender(send), &sender_task);
+
+    auto conference_callbacks       = ConferenceCallbacks();
+    conference_callbacks.ws_context = &ws_context;
+    auto conference                 = std::unique_ptr<conference::Conference>();
+    auto jingle_handler             = std::unique_ptr<JingleHandler>();
+
+    // gain jid from server, and start joining the conference as soon as the jid is bound
     {
-        auto callbacks        = XMPPNegotiatorCallbacks();
-        callbacks.ws_context  = &ws_context;
-        const auto negotiator = xmpp::Negotiator::create(host, &callbacks);
+        auto callbacks             = XMPPNegotiatorCallbacks();
+        callbacks.ws_context       = &ws_context;
+        const auto negotiator      = xmpp::Negotiator::create(host, &callbacks);
+        negotiator->stream_manager = &stream_manager;
+        negotiator->join_trace     = &join_trace;
 
-        ws_context.handler = [&negotiator, &event](const std::span<const std::byte> data) -> coop::Async<void> {
+        callbacks.on_bound_handler = [&](const xmpp::Jid& jid) -> void {
+            conference = conference::Conference::create(
+                conference::Config{
+                    .jid              = jid,
+                    .room             = room,
+                    .nick             = "libjitsimeet-example",
+                    .video_codec_type = video_codec_type,
+                    .audio_muted      = false,
+                    .video_muted      = false,
+                    .outbound_queue   = &outbound_queue,
+                    .stream_manager   = &stream_manager,
+                    .join_trace       = &join_trace,
+                },
+                &conference_callbacks);
+            // session-initiate may arrive before negotiation finishes
+            jingle_handler = std::make_unique<JingleHandler>(audio_codec_type, video_codec_type, jid, ext_sv, &conference->participants, &initiated);
+            jingle_handler->set_join_trace(&join_trace);
+            jingle_handler->set_cert_pool(cert_pool.get());
+            jingle_handler->set_trickle_handler([&injector, &conference, &jingle_handler]() -> void {
+                // on an ice mainloop thread, send from the conference thread
+                injector.inject_task(send_transport_info(*conference, *jingle_handler));
+            });
+            conference_callbacks.jingle_handler = jingle_handler.get();
+            conference->start_negotiation();
+        };
+        ws_context.handler = [&negotiator, &conference, &event](const std::span<const std::byte> data) -> coop::Async<void> {
             switch(negotiator->feed_payload(from_span(data))) {
             case xmpp::FeedResult::Continue:
                 break;
@@ -129,68 +217,63 @@ auto async_main(const int argc, const char* const argv[]) -> coop::Async<int> {
             case xmpp::FeedResult::Done:
                 event.notify();
                 break;
+            case xmpp::FeedResult::Forward:
+                conference->feed_payload(from_span(data));
+                break;
             }
             co_return;
         };
         negotiator->start_negotiation();
         co_await event;
 
-        jid    = std::move(negotiator->jid);
         ext_sv = std::move(negotiator->external_services);
+        jingle_handler->set_external_services(ext_sv);
+        // resolve stun/turn servers and gather candidates while waiting for session-initiate
+        agent_pool = ice::AgentPool::create({}, ice::MainloopPool::get(), ext_sv);
+        jingle_handler->set_agent_pool(agent_pool.get());
+        runner.push_task(warm_up_agents(*agent_pool));
     }
 
     // join conference
     {
-        constexpr auto audio_codec_type = CodecType::Opus;
-        constexpr auto video_codec_type = CodecType::H264;
-
-        auto jingle_handler      = JingleHandler(audio_codec_type, video_codec_type, jid, ext_sv, &event);
-        auto callbacks           = ConferenceCallbacks();
-        callbacks.ws_context     = &ws_context;
-        callbacks.jingle_handler = &jingle_handler;
-        const auto conference    = conference::Conference::create(
-            conference::Config{
-                   .jid              = jid,
-                   .room             = room,
-                   .nick             = "libjitsimeet-example",
-                   .video_codec_type = video_codec_type,
-                   .audio_muted      = false,
-                   .video_muted      = false,
-            },
-            &callbacks);
-        ws_context.handler = [&conference](const std::span<const std::byte> data) -> coop::Async<void> {
+        ws_context.handler = [&conference, &outbound_queue, &ws_context](const std::span<const std::byte> data) -> coop::Async<void> {
+            // do not produce more replies while the socket is behind
+            if(!co_await outbound_queue.wait_capacity()) {
+                // dropping the frame would desync the conference, end the session instead
+                std::println("outbound queue failed, disconnecting");
+                ws_context.shutdown();
+                co_return;
+            }
             conference->feed_payload(from_span(data));
-            co_return;
         };
-        conference->start_negotiation();
-        co_await event;
+        co_await initiated;
         {
-            auto accept    = jingle_handler.build_accept_jingle().value();
-            auto accept_iq = xmpp::elm::iq.clone()
-                                 .append_attrs({
-                                     {"from", jid.as_full()},
-                                     {"to", conference->config.get_muc_local_focus_jid().as_full()},
-                                     {"type", "set"},
-                                 })
-                                 .append_children({
-                                     *jingle::deparse(accept),
-                                 });
-
-            conference->send_iq(std::move(accept_iq), [](bool success) -> void {
-                dynamic_assert(success, "failed to send accept iq");
-            });
+            const auto accept    = jingle_handler->build_accept_jingle().value();
+            auto       accept_iq = jingle_iq(*conference, accept);
+
+            join_trace.begin(trace::Phase::Accept);
+            conference->send_iq(
+                std::move(accept_iq), [&join_trace](bool success) -> void {
+                    dynamic_assert(success, "failed to send accept iq");
+                    join_trace.end(trace::Phase::Accept);
+                },
+                outbound::Priority::High);
         }
 
-        auto colibri = colibri::Colibri::connect(jingle_handler.get_session().initiate_jingle, secure);
+        join_trace.begin(trace::Phase::ColibriConnect);
+        auto colibri = colibri::Colibri::connect(jingle_handler->get_session().initiate_jingle, secure);
         if(colibri) {
             colibri->set_last_n(5);
         }
+        join_trace.end(trace::Phase::ColibriConnect);
+        std::print("{}", join_trace.to_string());
 
-        auto ping_task = coop::TaskHandle();
-        runner.push_task(pinger_main(*conference), &ping_task);
+        auto keepalive_task = coop::TaskHandle();
+        runner.push_task(keepalive_main(*conference, ws_context), &keepalive_task);
         co_await ws_context.disconnected;
-        ping_task.cancel();
+        keepalive_task.cancel();
     }
+    sender_task.cancel();
     ws_task.cancel();
     co_return 0;
 }
@@ -0,0 +1,74 @@
+#include <algorithm>
+
+#include "host.hpp"
+#include "macros/logger.hpp"
+
+namespace host {
+namespace {
+auto logger = Logger("host");
+
+auto keep_alive(Shard& shard) -> coop::Async<void> {
+    co_await shard.stop;
+}
+
+auto notify_stop(Shard& shard) -> coop::Async<void> {
+    shard.stop.notify();
+    co_return;
+}
+
+auto run_placed(Shard& shard, coop::Async<void> task) -> coop::Async<void> {
+    co_await task;
+    shard.load.fetch_sub(1, std::memory_order_relaxed);
+}
+} // namespace
+
+auto Host::get_least_loaded() -> Shard& {
+    auto best = shards[0].get();
+    for(const auto& shard : shards) {
+        if(shard->load.load(std::memory_order_relaxed) < best->load.load(std::memory_order_relaxed)) {
+            best = shard.get();
+        }
+    }
+    return *best;
+}
+
+auto Host::place(const TaskFactory& factory) -> Shard& {
+    auto& shard = get_least_loaded();
+    // count it before injecting, so that concurrent placements see the new load
+    shard.load.fetch_add(1, std::memory_order_relaxed);
+    shard.injector.inject_task(run_placed(shard, factory(shard)));
+    LOG_DEBUG(logger, "placed task on shard {} load={}", shard.index, shard.load.load(std::memory_order_relaxed));
+    return shard;
+}
+
+auto Host::stop() -> void {
+    for(const auto& shard : shards) {
+        if(shard->thread.joinable()) {
+            shard->injector.inject_task(notify_stop(*shard));
+        }
+    }
+    for(const auto& shard : shards) {
+        if(shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+auto Host::create(size_t shard_count) -> std::unique_ptr<Host> {
+    if(shard_count == 0) {
+        shard_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    auto host = std::unique_ptr<Host>(new Host());
+    for(auto i = 0uz; i < shard_count; i += 1) {
+        auto& shard = *host->shards.emplace_back(new Shard());
+        shard.index = i;
+        shard.runner.push_task(keep_alive(shard));
+        shard.thread = std::thread([&shard]() { shard.runner.run(); });
+    }
+    return host;
+}
+
+Host::~Host() {
+    stop();
+}
+} // namespace host
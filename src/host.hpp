@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <coop/generator.hpp>
+#include <coop/runner.hpp>
+#include <coop/single-event.hpp>
+#include <coop/task-injector.hpp>
+
+namespace host {
+// one runner thread, conferences placed here live on it until they finish
+struct Shard {
+    coop::Runner       runner;
+    coop::TaskInjector injector = coop::TaskInjector(runner); // only way to reach the runner from other threads
+    coop::SingleEvent  stop;                                  // keeps the runner alive until notified
+    std::thread        thread;
+    std::atomic_size_t load = 0; // number of placed tasks not finished yet
+    size_t             index;
+};
+
+using TaskFactory = std::function<coop::Async<void>(Shard& shard)>;
+
+// runs many conferences on a fixed pool of threads, one shard per core
+// everything belonging to a conference (websocket context, Conference, JingleHandler) should be created
+// inside the placed task, so that it is only touched from the shard thread
+struct Host {
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    // factory is called on the calling thread, the returned task is run on the least loaded shard
+    // thread safe
+    auto place(const TaskFactory& factory) -> Shard&;
+    auto get_least_loaded() -> Shard&;
+    // stops every shard after its placed tasks finish, and joins the threads
+    auto stop() -> void;
+
+    // shard_count == 0 means one per core
+    static auto create(size_t shard_count = 0) -> std::unique_ptr<Host>;
+
+    ~Host();
+};
+} // namespace host
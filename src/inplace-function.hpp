@@ -0,0 +1,93 @@
+#pragma once
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// std::function like wrapper which never allocates
+// the callable must fit in the inline storage, checked at compile time
+template <class Signature, size_t capacity = 48>
+class InplaceFunction;
+
+template <class R, class... Args, size_t capacity>
+class InplaceFunction<R(Args...), capacity> {
+  private:
+    struct VTable {
+        R (*invoke)(void* storage, Args... args);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+
+    template <class T>
+    static auto get(void* const storage) -> T* {
+        return std::launder(static_cast<T*>(storage));
+    }
+
+    template <class T>
+    static constexpr auto vtable_for = VTable{
+        .invoke = [](void* const storage, Args... args) -> R {
+            return (*get<T>(storage))(std::forward<Args>(args)...);
+        },
+        .move = [](void* const dst, void* const src) -> void {
+            new(dst) T(std::move(*get<T>(src)));
+            get<T>(src)->~T();
+        },
+        .destroy = [](void* const storage) -> void {
+            get<T>(storage)->~T();
+        },
+    };
+
+    alignas(std::max_align_t) std::byte storage[capacity];
+    const VTable* vtable = nullptr;
+
+    auto reset() -> void {
+        if(vtable != nullptr) {
+            vtable->destroy(storage);
+            vtable = nullptr;
+        }
+    }
+
+  public:
+    explicit operator bool() const {
+        return vtable != nullptr;
+    }
+
+    auto operator()(Args... args) -> R {
+        return vtable->invoke(storage, std::forward<Args>(args)...);
+    }
+
+    auto operator=(InplaceFunction&& o) -> InplaceFunction& {
+        if(this != &o) {
+            reset();
+            if(o.vtable != nullptr) {
+                o.vtable->move(storage, o.storage);
+                vtable = std::exchange(o.vtable, nullptr);
+            }
+        }
+        return *this;
+    }
+
+    InplaceFunction() = default;
+
+    InplaceFunction(std::nullptr_t) {
+    }
+
+    template <class F>
+        requires(!std::same_as<std::decay_t<F>, InplaceFunction> && std::invocable<std::decay_t<F>&, Args...>)
+    InplaceFunction(F&& f) {
+        using T = std::decay_t<F>;
+        static_assert(sizeof(T) <= capacity, "callable too large for inline storage");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "callable over-aligned");
+        new(storage) T(std::forward<F>(f));
+        vtable = &vtable_for<T>;
+    }
+
+    InplaceFunction(InplaceFunction&& o) {
+        *this = std::move(o);
+    }
+
+    ~InplaceFunction() {
+        reset();
+    }
+};
@@ -0,0 +1,102 @@
+#include <bit>
+
+#include "iq-tracker.hpp"
+#include "macros/logger.hpp"
+
+namespace conference {
+namespace {
+auto logger = Logger("iq");
+} // namespace
+
+auto RttHistogram::record(const std::chrono::microseconds rtt) -> void {
+    const auto ms     = uint64_t(std::chrono::duration_cast<std::chrono::milliseconds>(rtt).count());
+    const auto bucket = std::min<size_t>(std::bit_width(ms), bucket_count - 1);
+    buckets[bucket] += 1;
+    count += 1;
+    total += rtt;
+    min = std::min(min, rtt);
+    max = std::max(max, rtt);
+}
+
+auto RttHistogram::get_mean() const -> std::chrono::microseconds {
+    return count == 0 ? std::chrono::microseconds() : total / count;
+}
+
+auto RttHistogram::get_percentile(const double p) const -> std::chrono::milliseconds {
+    if(count == 0) {
+        return {};
+    }
+    const auto target = std::min(uint64_t(p * count), uint64_t(count - 1));
+    auto       sum    = uint64_t(0);
+    for(auto i = 0uz; i < buckets.size(); i += 1) {
+        sum += buckets[i];
+        if(sum > target) {
+            return std::chrono::milliseconds(uint64_t(1) << i);
+        }
+    }
+    return {};
+}
+
+auto IqTracker::add(std::string id, const std::string_view kind, IqCallback on_result) -> void {
+    const auto now = Clock::now();
+    deadlines.push(Deadline{now + timeout, id});
+    pending.insert_or_assign(std::move(id), Entry{
+                                                .kind      = std::string(kind),
+                                                .sent_at   = now,
+                                                .deadline  = now + timeout,
+                                                .on_result = std::move(on_result),
+                                            });
+}
+
+auto IqTracker::resolve(const std::string_view id, const bool success) -> bool {
+    const auto i = pending.find(id);
+    if(i == pending.end()) {
+        return false;
+    }
+    auto entry = std::move(i->second);
+    pending.erase(i);
+
+    auto& histogram = stats[entry.kind];
+    histogram.record(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - entry.sent_at));
+    if(!success) {
+        histogram.errors += 1;
+    }
+    // the callback may send another iq, so call it after the entry is gone
+    if(entry.on_result) {
+        entry.on_result(success);
+    }
+    return true;
+}
+
+auto IqTracker::expire(const Clock::time_point now) -> size_t {
+    auto expired = 0uz;
+    while(!deadlines.empty() && deadlines.top().time <= now) {
+        const auto id = deadlines.top().id;
+        deadlines.pop();
+        // resolved iqs leave stale deadlines behind, skip them
+        const auto i = pending.find(id);
+        if(i == pending.end() || i->second.deadline > now) {
+            continue;
+        }
+        auto entry = std::move(i->second);
+        pending.erase(i);
+        LOG_ERROR(logger, "iq {}({}) timed out", id, entry.kind);
+        stats[entry.kind].timeouts += 1;
+        expired += 1;
+        if(entry.on_result) {
+            entry.on_result(false);
+        }
+    }
+    return expired;
+}
+
+auto IqTracker::get_next_deadline() -> std::optional<Clock::time_point> {
+    while(!deadlines.empty() && !pending.contains(deadlines.top().id)) {
+        deadlines.pop();
+    }
+    if(deadlines.empty()) {
+        return std::nullopt;
+    }
+    return deadlines.top().time;
+}
+} // namespace conference
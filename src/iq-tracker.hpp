@@ -0,0 +1,64 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <optional>
+#include <queue>
+#include <string>
+
+#include "inplace-function.hpp"
+#include "util/string-map.hpp"
+
+namespace conference {
+using IqCallback = InplaceFunction<void(bool)>;
+
+struct RttHistogram {
+    // bucket 0 counts round trips below 1ms, bucket i counts [2^(i-1), 2^i) ms
+    // the last bucket also holds everything above
+    static constexpr auto bucket_count = 16;
+
+    std::array<uint32_t, bucket_count> buckets  = {};
+    uint32_t                           count    = 0;
+    uint32_t                           errors   = 0; // answered with type="error", included in count
+    uint32_t                           timeouts = 0; // not included in count
+    std::chrono::microseconds          total    = {};
+    std::chrono::microseconds          min      = std::chrono::microseconds::max();
+    std::chrono::microseconds          max      = {};
+
+    auto record(std::chrono::microseconds rtt) -> void;
+    auto get_mean() const -> std::chrono::microseconds;
+    // upper bound of the bucket which contains the percentile, p in [0, 1]
+    auto get_percentile(double p) const -> std::chrono::milliseconds;
+};
+
+struct IqTracker {
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string       kind;
+        Clock::time_point sent_at;
+        Clock::time_point deadline;
+        IqCallback        on_result;
+    };
+
+    struct Deadline {
+        Clock::time_point time;
+        std::string       id;
+
+        auto operator>(const Deadline& o) const -> bool {
+            return time > o.time;
+        }
+    };
+
+    StringMap<Entry>        pending; // keyed by iq id
+    StringMap<RttHistogram> stats;   // keyed by iq kind, the name of the first child
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
+    Clock::duration timeout = std::chrono::seconds(30);
+
+    auto add(std::string id, std::string_view kind, IqCallback on_result) -> void;
+    // returns false if the id is not pending
+    auto resolve(std::string_view id, bool success) -> bool;
+    // fails every pending iq whose deadline has passed, returns the number of expired iqs
+    auto expire(Clock::time_point now = Clock::now()) -> size_t;
+    auto get_next_deadline() -> std::optional<Clock::time_point>;
+};
+} // namespace conference
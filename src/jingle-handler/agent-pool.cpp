@@ -0,0 +1,45 @@
+#include "../macros/logger.hpp"
+#include "agent-pool.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "../macros/unwrap.hpp"
+
+namespace ice {
+namespace {
+auto logger = Logger("ice");
+} // namespace
+
+auto AgentPool::fill() -> bool {
+    auto lock = std::unique_lock(mutex);
+    while(entries.size() < config.capacity) {
+        lock.unlock();
+        unwrap_mut(agent, ice::create(*mainloop_pool, external_services));
+        lock.lock();
+        entries.push_back(Entry{.agent = std::move(agent), .created = Clock::now()});
+    }
+    LOG_DEBUG(logger, "{} agents ready", entries.size());
+    return true;
+}
+
+auto AgentPool::acquire() -> std::optional<Agent> {
+    const auto now  = Clock::now();
+    auto       lock = std::lock_guard(mutex);
+    while(!entries.empty()) {
+        auto entry = std::move(entries.front());
+        entries.pop_front();
+        if(now - entry.created < config.max_age) {
+            return std::move(entry.agent);
+        }
+        LOG_DEBUG(logger, "dropping stale agent");
+    }
+    return std::nullopt;
+}
+
+auto AgentPool::create(const AgentPoolConfig config, MainloopPool& mainloop_pool, std::vector<xmpp::Service> external_services) -> std::unique_ptr<AgentPool> {
+    auto pool               = std::unique_ptr<AgentPool>(new AgentPool());
+    pool->config            = config;
+    pool->mainloop_pool     = &mainloop_pool;
+    pool->external_services = std::move(external_services);
+    return pool;
+}
+} // namespace ice
@@ -0,0 +1,40 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ice.hpp"
+
+namespace ice {
+struct AgentPoolConfig {
+    size_t capacity = 1;
+    // idle agents are dropped after this, their server reflexive and relayed candidates may be stale
+    std::chrono::seconds max_age = std::chrono::minutes(5);
+};
+
+// agents which are created and gather candidates before session-initiate arrives
+struct AgentPool {
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        Agent             agent;
+        Clock::time_point created;
+    };
+
+    AgentPoolConfig            config;
+    MainloopPool*              mainloop_pool;
+    std::vector<xmpp::Service> external_services;
+    std::mutex                 mutex;
+    std::deque<Entry>          entries;
+
+    // creates agents up to capacity, resolve stun/turn hosts beforehand to avoid blocking
+    auto fill() -> bool;
+    // nullopt if the pool is empty, the caller should create an agent then
+    // thread safe
+    auto acquire() -> std::optional<Agent>;
+
+    static auto create(AgentPoolConfig config, MainloopPool& mainloop_pool, std::vector<xmpp::Service> external_services) -> std::unique_ptr<AgentPool>;
+};
+} // namespace ice
@@ -0,0 +1,116 @@
+#include <iomanip>
+#include <span>
+#include <sstream>
+
+#include "../crypto/sha.hpp"
+#include "../macros/logger.hpp"
+#include "cert-pool.hpp"
+#include "cert.hpp"
+#include "pem.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "../macros/unwrap.hpp"
+
+namespace cert {
+namespace {
+auto logger = Logger("cert");
+
+auto digest_str(const std::span<const std::byte> digest) -> std::string {
+    auto ss = std::stringstream();
+    ss << std::hex;
+    ss << std::uppercase;
+    for(const auto b : digest) {
+        ss << std::setw(2) << std::setfill('0') << static_cast<int>(b) << ":";
+    }
+    auto r = ss.str();
+    r.pop_back();
+    return r;
+}
+
+auto worker_main(Pool& pool) -> void {
+    auto lock = std::unique_lock(pool.mutex);
+    while(true) {
+        pool.refill.wait(lock, [&pool]() { return pool.stopping || pool.materials.size() < pool.config.low_water; });
+        while(!pool.stopping && pool.materials.size() < pool.config.capacity) {
+            lock.unlock();
+            auto material = generate_material();
+            lock.lock();
+            if(!material) {
+                // retry when the next acquire wakes us up
+                pool.refill.wait(lock);
+                break;
+            }
+            pool.materials.push_back(std::move(*material));
+        }
+        if(pool.stopping) {
+            return;
+        }
+    }
+}
+} // namespace
+
+auto generate_material() -> std::optional<Material> {
+    const auto cert = AutoCert(cert_new());
+    ensure(cert);
+    const auto cert_der = serialize_cert_der(cert.get());
+    ensure(cert_der);
+    const auto priv_key_der = serialize_private_key_pkcs8_der(cert.get());
+    ensure(priv_key_der);
+    unwrap(fingerprint, crypto::sha::calc_sha256(*cert_der));
+    auto material = Material{
+        .fingerprint_str = digest_str(fingerprint),
+        .cert_pem        = pem::encode("CERTIFICATE", *cert_der),
+        .priv_key_pem    = pem::encode("PRIVATE KEY", *priv_key_der),
+    };
+    LOG_DEBUG(logger, "fingerprint: {}", material.fingerprint_str.data());
+    LOG_DEBUG(logger, "cert: {}", material.cert_pem.data());
+    LOG_DEBUG(logger, "priv_key: {}", material.priv_key_pem.data());
+    return material;
+}
+
+auto Pool::acquire() -> std::optional<Material> {
+    {
+        auto lock = std::unique_lock(mutex);
+        if(!materials.empty()) {
+            if(config.reuse) {
+                return materials.front();
+            }
+            auto material = std::move(materials.front());
+            materials.pop_front();
+            if(materials.size() < config.low_water) {
+                refill.notify_one();
+            }
+            return material;
+        }
+        refill.notify_one();
+    }
+    LOG_WARN(logger, "certificate pool is empty");
+    return generate_material();
+}
+
+auto Pool::stop() -> void {
+    {
+        const auto lock = std::lock_guard(mutex);
+        stopping        = true;
+    }
+    refill.notify_one();
+    if(worker.joinable()) {
+        worker.join();
+    }
+}
+
+auto Pool::create(PoolConfig config) -> std::unique_ptr<Pool> {
+    if(config.reuse) {
+        // only one is ever handed out
+        config.capacity  = 1;
+        config.low_water = 1;
+    }
+    auto pool    = std::unique_ptr<Pool>(new Pool{.config = config});
+    pool->worker = std::thread(worker_main, std::ref(*pool));
+    return pool;
+}
+
+Pool::~Pool() {
+    stop();
+}
+} // namespace cert
@@ -0,0 +1,46 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace cert {
+// everything a jingle session needs from a dtls certificate
+struct Material {
+    std::string fingerprint_str; // sha-256, colon separated upper case hex
+    std::string cert_pem;
+    std::string priv_key_pem;
+};
+
+// generates a new p-256 certificate, slow
+auto generate_material() -> std::optional<Material>;
+
+struct PoolConfig {
+    size_t capacity  = 4;
+    size_t low_water = 2; // refill starts when fewer certificates are left
+    // hand out one long-lived certificate to every session instead of a fresh one each
+    bool reuse = false;
+};
+
+// pre-generates certificates on a background thread, so that session-initiate does not wait for them
+struct Pool {
+    PoolConfig              config;
+    std::mutex              mutex;
+    std::condition_variable refill;
+    std::deque<Material>    materials;
+    bool                    stopping = false;
+    std::thread             worker;
+
+    // generates one synchronously only if the pool is empty
+    // thread safe
+    auto acquire() -> std::optional<Material>;
+    auto stop() -> void;
+
+    static auto create(PoolConfig config = {}) -> std::unique_ptr<Pool>;
+
+    ~Pool();
+};
+} // namespace cert
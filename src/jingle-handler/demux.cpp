@@ -0,0 +1,97 @@
+#include "demux.hpp"
+
+namespace demux {
+namespace {
+// rfc 7983 section 7
+constexpr auto first_byte_table = [] {
+    auto table = std::array<PacketClass, 256>();
+    table.fill(PacketClass::Unknown);
+    for(auto i = 0; i <= 3; i += 1) {
+        table[i] = PacketClass::Stun;
+    }
+    for(auto i = 16; i <= 19; i += 1) {
+        table[i] = PacketClass::Zrtp;
+    }
+    for(auto i = 20; i <= 63; i += 1) {
+        table[i] = PacketClass::Dtls;
+    }
+    for(auto i = 64; i <= 79; i += 1) {
+        table[i] = PacketClass::TurnChannel;
+    }
+    for(auto i = 128; i <= 191; i += 1) {
+        table[i] = PacketClass::Rtp;
+    }
+    return table;
+}();
+
+// fixed header sizes up to the ssrc
+constexpr auto rtp_header_size  = 12uz;
+constexpr auto rtcp_header_size = 8uz;
+
+auto read_u32(const std::span<const std::byte> data, const size_t offset) -> uint32_t {
+    return uint32_t(data[offset]) << 24 | uint32_t(data[offset + 1]) << 16 | uint32_t(data[offset + 2]) << 8 | uint32_t(data[offset + 3]);
+}
+} // namespace
+
+auto classify(const std::span<const std::byte> data) -> PacketClass {
+    if(data.size() < 2) {
+        return PacketClass::Unknown;
+    }
+    const auto klass = first_byte_table[size_t(data[0])];
+    if(klass != PacketClass::Rtp) {
+        return klass;
+    }
+    // rtcp packet types 192..223 collide with rtp payload types 64..95 plus the marker bit, which are not used
+    const auto type = uint8_t(data[1]);
+    return type >= 192 && type <= 223 ? PacketClass::Rtcp : PacketClass::Rtp;
+}
+
+auto get_ssrc(const std::span<const std::byte> data, const PacketClass klass) -> std::optional<uint32_t> {
+    switch(klass) {
+    case PacketClass::Rtp:
+        return data.size() >= rtp_header_size ? std::optional(read_u32(data, 8)) : std::nullopt;
+    case PacketClass::Rtcp:
+        return data.size() >= rtcp_header_size ? std::optional(read_u32(data, 4)) : std::nullopt;
+    default:
+        return std::nullopt;
+    }
+}
+
+auto Demuxer::feed(const std::span<const std::byte> data, const ice::PacketInfo& info) -> void {
+    const auto klass = classify(data);
+    counts[size_t(klass)] += 1;
+    switch(klass) {
+    case PacketClass::Dtls:
+        if(on_dtls) {
+            on_dtls(data, info);
+        }
+        return;
+    case PacketClass::Rtp:
+    case PacketClass::Rtcp: {
+        const auto& handler = klass == PacketClass::Rtp ? on_rtp : on_rtcp;
+        const auto  ssrc    = get_ssrc(data, klass);
+        const auto  source  = ssrc ? ssrc_table->load()->find(*ssrc) : nullptr;
+        if(source == nullptr) {
+            unknown_ssrc += 1;
+            if(on_unknown_ssrc) {
+                on_unknown_ssrc(data, info);
+            }
+            return;
+        }
+        if(handler) {
+            handler(*source, data, info);
+        }
+        return;
+    }
+    default:
+        // stun is consumed by libnice, the rest is not used by jitsi
+        return;
+    }
+}
+
+auto Demuxer::as_sink() -> ice::PacketSink {
+    return [this](const std::span<const std::byte> data, const ice::PacketInfo& info) -> void {
+        feed(data, info);
+    };
+}
+} // namespace demux
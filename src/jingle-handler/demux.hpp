@@ -0,0 +1,48 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include "packet-ring.hpp"
+#include "ssrc-table.hpp"
+
+namespace demux {
+enum class PacketClass : uint8_t {
+    Unknown,
+    Stun,
+    Zrtp,
+    Dtls,
+    TurnChannel,
+    Rtp,
+    Rtcp,
+};
+
+constexpr auto packet_class_count = size_t(PacketClass::Rtcp) + 1;
+
+// rfc 7983 on the first byte, then rfc 5761 on the second to tell rtcp from rtp
+auto classify(std::span<const std::byte> data) -> PacketClass;
+// media ssrc of rtp, sender ssrc of rtcp
+auto get_ssrc(std::span<const std::byte> data, PacketClass klass) -> std::optional<uint32_t>;
+
+using Handler      = std::function<void(std::span<const std::byte> data, const ice::PacketInfo& info)>;
+using MediaHandler = std::function<void(const Source& source, std::span<const std::byte> data, const ice::PacketInfo& info)>;
+
+// sorts datagrams of the bundled component and routes media by ssrc
+// runs on the mainloop thread, sources may be added or removed concurrently
+// a lookup is a single pointer load, the owner reports quiescent states of the mainloop thread between packets
+struct Demuxer {
+    SharedSSRCTable* ssrc_table;
+    MediaHandler     on_rtp;
+    MediaHandler     on_rtcp;
+    Handler          on_dtls;
+    Handler          on_unknown_ssrc;
+
+    std::array<uint64_t, packet_class_count> counts       = {};
+    uint64_t                                 unknown_ssrc = 0;
+
+    auto feed(std::span<const std::byte> data, const ice::PacketInfo& info) -> void;
+    // sink which feeds this demuxer, the demuxer must outlive it
+    auto as_sink() -> ice::PacketSink;
+};
+} // namespace demux
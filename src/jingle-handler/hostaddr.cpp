@@ -1,26 +1,89 @@
-#include <cstdint>
-#include <string>
+#include <array>
+
+#include <coop/thread.hpp>
 
 #if !defined _WIN32
 #include <netdb.h>
+#include <sys/socket.h>
 #else
 #include <WinSock2.h>
+#include <ws2tcpip.h>
 #endif
 
-auto hostname_to_addr(const char* const hostname) -> std::string {
-    auto r = std::string();
+#include "../macros/logger.hpp"
+#include "hostaddr.hpp"
+
+namespace hostaddr {
+namespace {
+auto logger = Logger("hostaddr");
 
-    const auto host = gethostbyname(hostname);
-    if(host == NULL || host->h_length != 4 || host->h_addrtype != AF_INET) {
-        return r;
+auto lookup(const char* const hostname) -> std::string {
+    auto hints        = addrinfo();
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    auto result       = (addrinfo*)(nullptr);
+    if(const auto ret = getaddrinfo(hostname, nullptr, &hints, &result); ret != 0) {
+        LOG_ERROR(logger, "failed to resolve {}: {}", hostname, gai_strerror(ret));
+        return {};
     }
-    for(auto i = 0; host->h_addr_list[i]; i += 1) {
-        auto addr = (uint8_t*)host->h_addr_list[i];
-        for(auto i = 0; i < 4; i += 1) {
-            r += std::to_string(addr[i]);
-            r += ".";
-        }
-        r.pop_back();
+    // the first one is the preferred one, getaddrinfo sorts them by rfc6724
+    auto buf = std::array<char, NI_MAXHOST>();
+    auto r   = std::string();
+    if(getnameinfo(result->ai_addr, result->ai_addrlen, buf.data(), buf.size(), nullptr, 0, NI_NUMERICHOST) == 0) {
+        r = buf.data();
     }
+    freeaddrinfo(result);
     return r;
 }
+} // namespace
+
+auto Resolver::find(const std::string_view host) -> std::optional<std::string> {
+    const auto lock = std::lock_guard(mutex);
+    const auto i    = cache.find(host);
+    if(i == cache.end() || i->second.expires <= Clock::now()) {
+        return std::nullopt;
+    }
+    return i->second.addr;
+}
+
+auto Resolver::resolve_blocking(const std::string_view host) -> std::string {
+    if(auto addr = find(host); addr) {
+        return std::move(*addr);
+    }
+    auto addr = lookup(std::string(host).data());
+    LOG_DEBUG(logger, "resolved {} to {}", host, addr);
+
+    const auto lock = std::lock_guard(mutex);
+    cache.insert_or_assign(std::string(host), Entry{
+                                                  .addr    = addr,
+                                                  .expires = Clock::now() + (addr.empty() ? negative_ttl : ttl),
+                                              });
+    return addr;
+}
+
+auto Resolver::resolve(const std::string host) -> coop::Async<std::string> {
+    if(auto addr = find(host); addr) {
+        co_return std::move(*addr);
+    }
+    auto addr = std::string();
+    co_await coop::run_blocking([this, &host, &addr]() { addr = resolve_blocking(host); });
+    co_return addr;
+}
+
+auto Resolver::prefetch(const std::vector<xmpp::Service> services) -> coop::Async<void> {
+    for(const auto& service : services) {
+        if(service.type == "stun" || service.type == "turn" || service.type == "turns") {
+            co_await resolve(service.host);
+        }
+    }
+}
+
+auto Resolver::get() -> Resolver& {
+    static auto resolver = Resolver();
+    return resolver;
+}
+} // namespace hostaddr
+
+auto hostname_to_addr(const char* const hostname) -> std::string {
+    return hostaddr::Resolver::get().resolve_blocking(hostname);
+}
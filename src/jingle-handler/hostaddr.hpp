@@ -1,5 +1,46 @@
 #pragma once
+#include <chrono>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
-auto hostname_to_addr(const char* hostname) -> std::string;
+#include <coop/generator.hpp>
+
+#include "../util/string-map.hpp"
+#include "../xmpp/extdisco.hpp"
+
+namespace hostaddr {
+// process-wide cache of resolved stun/turn hosts, thread safe
+// getaddrinfo does not report record ttls, so entries live for a fixed ttl
+struct Resolver {
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string       addr; // empty if resolution failed
+        Clock::time_point expires;
+    };
 
+    std::mutex           mutex;
+    StringMap<Entry>     cache;
+    std::chrono::seconds ttl          = std::chrono::minutes(5);
+    std::chrono::seconds negative_ttl = std::chrono::seconds(30);
+
+    // never blocks, nullopt if the host is not cached
+    // a cached failure is returned as an empty string
+    auto find(std::string_view host) -> std::optional<std::string>;
+    // blocks on a cache miss
+    auto resolve_blocking(std::string_view host) -> std::string;
+    // resolves in a blocking thread
+    auto resolve(std::string host) -> coop::Async<std::string>;
+    // resolves stun/turn hosts in the background, so that ice setup finds them cached
+    auto prefetch(std::vector<xmpp::Service> services) -> coop::Async<void>;
+
+    static auto get() -> Resolver&;
+};
+} // namespace hostaddr
+
+// numeric address of hostname, ipv4 or ipv6, or empty string on failure
+// uses the cache of hostaddr::Resolver::get()
+auto hostname_to_addr(const char* hostname) -> std::string;
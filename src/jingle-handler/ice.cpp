@@ -59,12 +59,61 @@ auto set_stun_turn(NiceAgent* const                     agent,
     return true;
 }
 
-auto agent_recv_callback(NiceAgent* const /*agent*/, const guint /*stream_id*/, const guint /*component_id*/, const guint /*len*/, gchar* const buf, const gpointer /*user_data*/) -> void {
-    LOG_DEBUG(logger, "agent-recv: {}", buf);
+auto agent_recv_callback(NiceAgent* const /*agent*/, const guint /*stream_id*/, const guint /*component_id*/, const guint len, gchar* const buf, const gpointer user_data) -> void {
+    auto& receiver = *std::bit_cast<Receiver*>(user_data);
+    receiver.packets.fetch_add(1, std::memory_order_relaxed);
+    if(!receiver.sink) {
+        receiver.unhandled.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const auto info = PacketInfo{
+        .arrival = std::chrono::steady_clock::now(),
+        .len     = len,
+    };
+    receiver.sink(std::span(std::bit_cast<const std::byte*>(buf), len), info);
+}
+
+auto free_receiver(const gpointer data) -> void {
+    delete std::bit_cast<Receiver*>(data);
+}
+
+auto notify_gathered(GatheredCandidates& gathered) -> void {
+    // the handler may be replaced while the agent is gathering
+    auto handler = std::function<void()>();
+    {
+        auto lock = std::lock_guard(gathered.mutex);
+        handler   = gathered.on_gathered;
+    }
+    if(handler) {
+        handler();
+    }
 }
 
-auto candidate_gathering_done(NiceAgent* const /*agent*/, const guint /*stream_id*/, const gpointer /*user_data*/) -> void {
+auto new_candidate_full(NiceAgent* const /*agent*/, NiceCandidate* const candidate, const gpointer user_data) -> void {
+    auto& gathered = **std::bit_cast<std::shared_ptr<GatheredCandidates>*>(user_data);
+    {
+        auto lock = std::lock_guard(gathered.mutex);
+        gathered.candidates.emplace_back(nice_candidate_copy(candidate));
+    }
+    notify_gathered(gathered);
+}
+
+auto candidate_gathering_done(NiceAgent* const /*agent*/, const guint /*stream_id*/, const gpointer user_data) -> void {
     LOG_DEBUG(logger, "candidate-gathering-done");
+    auto& gathered = **std::bit_cast<std::shared_ptr<GatheredCandidates>*>(user_data);
+    {
+        auto lock     = std::lock_guard(gathered.mutex);
+        gathered.done = true;
+    }
+    notify_gathered(gathered);
+}
+
+// each handler owns a reference, glib drops it when the handler is gone
+auto connect_gathered(NiceAgent* const agent, const char* const signal, const GCallback callback, const std::shared_ptr<GatheredCandidates>& gathered) -> bool {
+    const auto destroy = [](const gpointer data, GClosure* const /*closure*/) -> void {
+        delete std::bit_cast<std::shared_ptr<GatheredCandidates>*>(data);
+    };
+    return g_signal_connect_data(agent, signal, callback, new std::shared_ptr<GatheredCandidates>(gathered), destroy, GConnectFlags(0)) > 0;
 }
 
 auto candidate_type_conv_table = std::array<std::pair<jingle::CandidateType, NiceCandidateType>, 4>{{
@@ -78,6 +127,10 @@ auto set_remote_candidates(NiceAgent* const               agent,
                            const jingle::IceUdpTransport& transport,
                            const guint                    stream_id,
                            const guint                    component_id) -> bool {
+    if(transport.candidate.empty()) {
+        // the focus may send candidates later with transport-info
+        return true;
+    }
 
     auto r    = true;
     auto list = (GSList*)(NULL);
@@ -111,34 +164,43 @@ end:
 }
 } // namespace
 
-auto MainloopWithRunner::create() -> MainloopWithRunner* {
-    const auto mainloop = g_main_loop_new(NULL, FALSE);
-    ensure(mainloop != NULL, "failed to create mainloop");
-
-    auto ret = new MainloopWithRunner();
-    ret->mainloop.reset(mainloop);
-    return ret;
-}
-
-auto MainloopWithRunner::start_runner() -> void {
-    runner = std::thread(g_main_loop_run, mainloop.get());
+auto GatheredCandidates::take() -> std::vector<AutoNiceCandidate> {
+    auto lock = std::lock_guard(mutex);
+    return std::exchange(candidates, {});
 }
 
-MainloopWithRunner::~MainloopWithRunner() {
-    if(runner.joinable()) {
-        g_main_loop_quit(mainloop.get());
-        runner.join();
+auto GatheredCandidates::set_on_gathered(std::function<void()> handler) -> void {
+    auto pending = false;
+    {
+        auto lock   = std::lock_guard(mutex);
+        on_gathered = handler;
+        pending     = !candidates.empty() || done;
+    }
+    // let the new owner catch up with what was gathered before, on the same thread as later notifications
+    if(pending && handler) {
+        const auto call = [](const gpointer data) -> gboolean {
+            (*std::bit_cast<std::function<void()>*>(data))();
+            return G_SOURCE_REMOVE;
+        };
+        const auto destroy = [](const gpointer data) -> void {
+            delete std::bit_cast<std::function<void()>*>(data);
+        };
+        g_main_context_invoke_full(context, G_PRIORITY_DEFAULT, call, new std::function<void()>(std::move(handler)), destroy);
     }
 }
 
-auto setup(const std::span<const xmpp::Service> external_services,
-           const jingle::IceUdpTransport* const transport) -> std::optional<Agent> {
-    auto mainloop = AutoMainloop(MainloopWithRunner::create());
-    ensure(mainloop.get() != nullptr);
-    const auto mainloop_ctx = g_main_loop_get_context(mainloop->mainloop.get());
+auto create(MainloopPool& pool, const std::span<const xmpp::Service> external_services) -> std::optional<Agent> {
+    auto       mainloop     = pool.acquire();
+    const auto mainloop_ctx = mainloop.get_context();
+    auto       gathered     = std::make_shared<GatheredCandidates>();
+    gathered->context       = mainloop_ctx;
 
     auto agent = AutoNiceAgent(nice_agent_new(mainloop_ctx, NICE_COMPATIBILITY_RFC5245));
     ensure(agent.get() != NULL, "failed to create nice agent");
+    // the conference thread may drop its reference while a callback is running on the mainloop
+    // so tie the receiver to the finalization of the agent instead
+    const auto receiver = new Receiver();
+    g_object_set_data_full(G_OBJECT(agent.get()), "receiver", receiver, free_receiver);
     g_object_set(agent.get(),
                  "ice-tcp", FALSE,
                  "upnp", FALSE,
@@ -149,31 +211,57 @@ auto setup(const std::span<const xmpp::Service> external_services,
     ensure(stream_id > 0, "failed to add stream");
     ensure(set_stun_turn(agent.get(), external_services, stream_id, component_id),
            "failed to setup stun & turn servers");
-    ensure(nice_agent_attach_recv(agent.get(), stream_id, component_id, mainloop_ctx, agent_recv_callback, nullptr) == TRUE,
+    ensure(nice_agent_attach_recv(agent.get(), stream_id, component_id, mainloop_ctx, agent_recv_callback, receiver) == TRUE,
            "failed to attach recv callback");
-    if(transport) {
-        ensure(nice_agent_set_remote_credentials(agent.get(), stream_id, transport->ufrag.data(), transport->pwd.data()) == TRUE,
-               "failed to set credentials");
-    }
-    ensure(g_signal_connect(agent.get(), "candidate-gathering-done", G_CALLBACK(candidate_gathering_done), nullptr) > 0,
+    ensure(connect_gathered(agent.get(), "new-candidate-full", G_CALLBACK(new_candidate_full), gathered),
+           "failed to register new-candidate-full callback");
+    ensure(connect_gathered(agent.get(), "candidate-gathering-done", G_CALLBACK(candidate_gathering_done), gathered),
            "failed to register candidate-gathering-done callback");
     ensure(nice_agent_gather_candidates(agent.get(), stream_id) == TRUE,
            "failed to gather candidates");
-    if(transport) {
-        ensure(set_remote_candidates(agent.get(), *transport, stream_id, component_id), "failed to add candidates");
-    }
 
     nice_debug_enable(logger.loglevel == Loglevel::Debug ? TRUE : FALSE);
-    mainloop->start_runner();
 
     return Agent{
         .mainloop     = std::move(mainloop),
+        .gathered     = std::move(gathered),
+        .receiver     = receiver,
         .agent        = std::move(agent),
         .stream_id    = stream_id,
         .component_id = component_id,
     };
 }
 
+auto setup(MainloopPool&                        pool,
+           const std::span<const xmpp::Service> external_services,
+           const jingle::IceUdpTransport* const transport,
+           std::function<void()>                on_gathered) -> std::optional<Agent> {
+    unwrap_mut(agent, create(pool, external_services));
+    agent.gathered->set_on_gathered(std::move(on_gathered));
+    if(transport) {
+        ensure(add_remote_candidates(agent, *transport));
+    }
+    return std::move(agent);
+}
+
+auto set_packet_sink(Agent& agent, PacketSink sink) -> void {
+    agent.receiver->sink = std::move(sink);
+}
+
+auto clear_packet_sink(Agent& agent) -> void {
+    const auto receiver = agent.receiver;
+    run_task(agent.mainloop.get_context(), [receiver]() -> void { receiver->sink = nullptr; });
+}
+
+auto add_remote_candidates(const Agent& agent, const jingle::IceUdpTransport& transport) -> bool {
+    if(!transport.ufrag.empty() && !transport.pwd.empty()) {
+        ensure(nice_agent_set_remote_credentials(agent.agent.get(), agent.stream_id, transport.ufrag.data(), transport.pwd.data()) == TRUE,
+               "failed to set credentials");
+    }
+    ensure(set_remote_candidates(agent.agent.get(), transport, agent.stream_id, agent.component_id), "failed to add candidates");
+    return true;
+}
+
 auto str_to_sockaddr(const char* const addr, const uint16_t port) -> NiceAddress {
     auto r = NiceAddress();
     if(inet_pton(AF_INET, addr, &r.s.ip4.sin_addr) == 1) {
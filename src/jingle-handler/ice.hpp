@@ -1,40 +1,68 @@
 #pragma once
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <span>
-#include <thread>
 
 #include <nice/agent.h>
 
 #include "../jingle/jingle.hpp"
 #include "../macros/autoptr.hpp"
 #include "../xmpp/extdisco.hpp"
+#include "mainloop-pool.hpp"
+#include "packet-ring.hpp"
 
 namespace ice {
-declare_autoptr(GMainLoop, GMainLoop, g_main_loop_unref);
 declare_autoptr(NiceAgent, NiceAgent, g_object_unref);
 declare_autoptr(GChar, gchar, g_free);
-
-struct MainloopWithRunner {
-    AutoGMainLoop mainloop;
-    std::thread   runner;
-
-    auto start_runner() -> void;
-
-    static auto create() -> MainloopWithRunner*;
-
-    ~MainloopWithRunner();
+declare_autoptr(NiceCandidate, NiceCandidate, nice_candidate_free);
+
+// local candidates in the order libnice found them, for trickle ice
+// filled on the mainloop thread, drained by the session owner
+struct GatheredCandidates {
+    std::mutex                     mutex;
+    std::vector<AutoNiceCandidate> candidates;
+    bool                           done    = false;
+    GMainContext*                  context = nullptr; // of the agent
+    // called on the mainloop thread after a candidate is queued or gathering finished
+    std::function<void()> on_gathered;
+
+    auto take() -> std::vector<AutoNiceCandidate>;
+    // schedules the handler on the mainloop thread if something was gathered before
+    auto set_on_gathered(std::function<void()> handler) -> void;
 };
 
-using AutoMainloop = std::unique_ptr<MainloopWithRunner>;
+// user data of the recv callback, owned by the nice agent and freed when it is finalized
+// libnice holds a reference to the agent while the callback runs, so it never outlives the receiver
+struct Receiver {
+    PacketSink           sink;
+    std::atomic_uint64_t packets   = 0;
+    std::atomic_uint64_t unhandled = 0; // arrived without a sink
+};
 
 struct Agent {
-    AutoMainloop  mainloop;
-    AutoNiceAgent agent;
-    guint         stream_id;
-    guint         component_id;
+    MainloopLease                       mainloop; // released after the agent
+    std::shared_ptr<GatheredCandidates> gathered; // shared with the signal handlers
+    Receiver*                           receiver; // owned by agent
+    AutoNiceAgent                       agent;
+    guint                               stream_id;
+    guint                               component_id;
 };
 
-auto setup(std::span<const xmpp::Service> external_services, const jingle::IceUdpTransport* transport) -> std::optional<Agent>;
+// creates an agent and starts gathering, remote parameters can follow later
+auto create(MainloopPool& pool, std::span<const xmpp::Service> external_services) -> std::optional<Agent>;
+// create and add_remote_candidates
+auto setup(MainloopPool&                  pool,
+           std::span<const xmpp::Service> external_services,
+           const jingle::IceUdpTransport* transport,
+           std::function<void()>          on_gathered = {}) -> std::optional<Agent>;
+// set before remote candidates are added, no media arrives until then
+auto set_packet_sink(Agent& agent, PacketSink sink) -> void;
+// drops the sink on the mainloop thread and waits for it, the sink is not running once this returns
+// libnice keeps its own reference to the agent during a callback, so dropping ours does not guarantee that
+auto clear_packet_sink(Agent& agent) -> void;
+// applies trickled remote candidates, and credentials if the transport carries them
+auto add_remote_candidates(const Agent& agent, const jingle::IceUdpTransport& transport) -> bool;
 
 auto str_to_sockaddr(const char* addr, uint16_t port) -> NiceAddress;
 auto sockaddr_to_str(const NiceAddress& addr) -> std::string;
@@ -1,14 +1,9 @@
-#include <iomanip>
-
-#include "../crypto/sha.hpp"
 #include "../jingle/jingle.hpp"
 #include "../macros/logger.hpp"
 #include "../random.hpp"
 #include "../util/charconv.hpp"
 #include "../util/pair-table.hpp"
-#include "cert.hpp"
 #include "jingle.hpp"
-#include "pem.hpp"
 
 #define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
 #include "../macros/unwrap.hpp"
@@ -42,7 +37,7 @@ struct DescriptionParseResult {
     int audio_hdrext_ssrc_audio_level = -1;
 };
 
-auto parse_rtp_description(const jingle::RTPDescription& desc, SSRCMap& ssrc_map) -> std::optional<DescriptionParseResult> {
+auto parse_rtp_description(const jingle::RTPDescription& desc, SSRCTable& ssrc_map, conference::ParticipantRegistry& participants) -> std::optional<DescriptionParseResult> {
     unwrap(media, desc.media);
     unwrap(source_type, source_type_str.find(media), "unknown media {}", media);
     auto r = DescriptionParseResult{};
@@ -107,24 +102,49 @@ auto parse_rtp_description(const jingle::RTPDescription& desc, SSRCMap& ssrc_map
     }
     // parse ssrc
     for(const auto& source : desc.source) {
-        ssrc_map[source.ssrc] = Source{
-            .ssrc           = source.ssrc,
-            .type           = source_type,
-            .participant_id = source.ssrc_info[0].owner,
-        };
+        ssrc_map.insert(Source{
+            .ssrc        = source.ssrc,
+            .type        = source_type,
+            .participant = participants.intern(source.ssrc_info[0].owner),
+        });
     }
     return r;
 }
 
-auto digest_str(const std::span<const std::byte> digest) -> std::string {
-    auto ss = std::stringstream();
-    ss << std::hex;
-    ss << std::uppercase;
-    for(const auto b : digest) {
-        ss << std::setw(2) << std::setfill('0') << static_cast<int>(b) << ":";
+auto collect_participants(const SSRCTable& table) -> std::vector<conference::ParticipantHandle> {
+    auto r = std::vector<conference::ParticipantHandle>();
+    r.reserve(table.size());
+    table.for_each([&r](const Source& source) -> void { r.push_back(source.participant); });
+    return r;
+}
+
+auto take_local_candidates(const ice::Agent& agent, trace::JoinTrace* const join_trace) -> std::optional<std::vector<jingle::Candidate>> {
+    // gathering finishes on the mainloop thread, the trace records when the conference thread notices it
+    if(join_trace != nullptr) {
+        auto lock = std::lock_guard(agent.gathered->mutex);
+        if(agent.gathered->done) {
+            join_trace->end(trace::Phase::IceGathering);
+        }
+    }
+    auto r = std::vector<jingle::Candidate>();
+    for(const auto& lc : agent.gathered->take()) {
+        unwrap(type, ice::candidate_type_from_nice(lc->type));
+        const auto addr = ice::sockaddr_to_str(lc->addr);
+        ensure(!addr.empty());
+        const auto  port                = ice::sockaddr_to_port(lc->addr);
+        static auto candidate_id_serial = std::atomic_int(0);
+        r.push_back(jingle::Candidate{
+            .component  = uint8_t(lc->component_id),
+            .generation = 0,
+            .port       = port,
+            .priority   = lc->priority,
+            .type       = type,
+            .foundation = lc->foundation,
+            .id         = std::format("candidate_{}", candidate_id_serial.fetch_add(1)),
+            .ip         = addr,
+            .protocol   = "udp",
+        });
     }
-    auto r = ss.str();
-    r.pop_back();
     return r;
 }
 } // namespace
@@ -151,9 +171,16 @@ auto JingleHandler::get_session() const -> const JingleSession& {
     return session;
 }
 
-auto JingleHandler::build_accept_jingle() const -> std::optional<jingle::Jingle> {
+auto JingleHandler::get_ssrc_table() -> SharedSSRCTable& {
+    return ssrc_table;
+}
+
+auto JingleHandler::build_accept_jingle() -> std::optional<jingle::Jingle> {
     auto& jingle = session.initiate_jingle;
 
+    unwrap(candidates, take_local_candidates(session.ice_agent, join_trace));
+    session.accepted = true;
+
     auto accept = jingle::Jingle{
         .action    = jingle::Action::SessionAccept,
         .sid       = jingle.sid,
@@ -241,26 +268,8 @@ auto JingleHandler::build_accept_jingle() const -> std::optional<jingle::Jingle>
             .pwd   = session.local_cred.pwd.get(),
             .ufrag = session.local_cred.ufrag.get(),
         };
-        // add candidates
-        const auto local_candidates = ice::get_local_candidates(session.ice_agent);
-        for(const auto lc : local_candidates.candidates) {
-            unwrap(type, ice::candidate_type_from_nice(lc->type));
-            const auto addr = ice::sockaddr_to_str(lc->addr);
-            ensure(!addr.empty());
-            const auto  port                = ice::sockaddr_to_port(lc->addr);
-            static auto candidate_id_serial = std::atomic_int(0);
-            transport.candidate.push_back(jingle::Candidate{
-                .component  = uint8_t(lc->component_id),
-                .generation = 0,
-                .port       = port,
-                .priority   = lc->priority,
-                .type       = type,
-                .foundation = lc->foundation,
-                .id         = std::format("candidate_{}", candidate_id_serial.fetch_add(1)),
-                .ip         = addr,
-                .protocol   = "udp",
-            });
-        }
+        // add candidates gathered so far, the rest are trickled with transport-info
+        transport.candidate = candidates;
         // add fingerprint
         transport.fingerprint.push_back(jingle::FingerPrint{
             .hash     = "sha-256",
@@ -288,16 +297,59 @@ auto JingleHandler::build_accept_jingle() const -> std::optional<jingle::Jingle>
     return accept;
 }
 
+auto JingleHandler::build_transport_info() -> std::optional<jingle::Jingle> {
+    if(!session.accepted) {
+        // still queued, build_accept_jingle will take them
+        return std::nullopt;
+    }
+    unwrap(candidates, take_local_candidates(session.ice_agent, join_trace));
+    if(candidates.empty()) {
+        return std::nullopt;
+    }
+
+    const auto& jingle = session.initiate_jingle;
+
+    auto info = jingle::Jingle{
+        .action    = jingle::Action::TransportInfo,
+        .sid       = jingle.sid,
+        .initiator = jingle.initiator,
+        .responder = jid.as_full(),
+    };
+    for(const auto name : {"audio", "video"}) {
+        info.content.push_back(
+            jingle::Content{
+                .name      = name,
+                .creator   = "responder",
+                .transport = {jingle::IceUdpTransport{
+                    .pwd       = session.local_cred.pwd.get(),
+                    .ufrag     = session.local_cred.ufrag.get(),
+                    .candidate = candidates,
+                }},
+            });
+    }
+    return info;
+}
+
+auto JingleHandler::on_transport_info(jingle::Jingle jingle) -> bool {
+    ensure(session.ice_agent.agent, "transport-info arrived before session-initiate");
+    for(const auto& c : jingle.content) {
+        for(const auto& transport : c.transport) {
+            ensure(ice::add_remote_candidates(session.ice_agent, transport));
+        }
+    }
+    return true;
+}
+
 auto JingleHandler::on_initiate(jingle::Jingle jingle) -> bool {
     auto codecs                        = std::vector<Codec>();
-    auto ssrc_map                      = SSRCMap();
+    auto ssrc_map                      = SSRCTable();
     auto video_hdrext_transport_cc     = -1;
     auto audio_hdrext_transport_cc     = -1;
     auto audio_hdrext_ssrc_audio_level = -1;
     auto transport                     = (const jingle::IceUdpTransport*)(nullptr);
     for(const auto& c : jingle.content) {
         for(const auto& d : c.description) {
-            unwrap(desc, parse_rtp_description(d, ssrc_map));
+            unwrap(desc, parse_rtp_description(d, ssrc_map, *participants));
             codecs.insert(codecs.end(), desc.codecs.begin(), desc.codecs.end());
             replace_default(video_hdrext_transport_cc, desc.video_hdrext_transport_cc);
             replace_default(audio_hdrext_transport_cc, desc.audio_hdrext_transport_cc);
@@ -308,36 +360,40 @@ auto JingleHandler::on_initiate(jingle::Jingle jingle) -> bool {
         }
     }
 
-    const auto cert = cert::AutoCert(cert::cert_new());
-    ensure(cert);
-    const auto cert_der = cert::serialize_cert_der(cert.get());
-    ensure(cert_der);
-    const auto priv_key_der = cert::serialize_private_key_pkcs8_der(cert.get());
-    ensure(priv_key_der);
-    unwrap(fingerprint, crypto::sha::calc_sha256(*cert_der));
-    auto fingerprint_str = digest_str(fingerprint);
-    auto cert_pem        = pem::encode("CERTIFICATE", *cert_der);
-    auto priv_key_pem    = pem::encode("PRIVATE KEY", *priv_key_der);
-    LOG_DEBUG(logger, "fingerprint: {}", fingerprint_str.data());
-    LOG_DEBUG(logger, "cert: {}", cert_pem.data());
-    LOG_DEBUG(logger, "priv_key: {}", priv_key_pem.data());
+    // before the agent can receive media
+    const auto previous = collect_participants(*ssrc_table.load());
+    ssrc_table.publish(std::move(ssrc_map));
+    move_source_refs(previous);
+
+    trace::begin(join_trace, trace::Phase::CertGeneration);
+    unwrap_mut(cert, cert_pool != nullptr ? cert_pool->acquire() : cert::generate_material());
+    trace::end(join_trace, trace::Phase::CertGeneration);
 
     const auto audio_ssrc     = rng::generate_random_uint32();
     const auto video_ssrc     = rng::generate_random_uint32();
     const auto video_rtx_ssrc = rng::generate_random_uint32();
 
-    unwrap_mut(ice_agent, ice::setup(external_services, transport));
+    trace::begin(join_trace, trace::Phase::IceGathering);
+    auto warm_agent = agent_pool != nullptr ? agent_pool->acquire() : std::nullopt;
+    if(!warm_agent) {
+        warm_agent = ice::create(mainloop_pool != nullptr ? *mainloop_pool : ice::MainloopPool::get(), external_services);
+    }
+    unwrap_mut(ice_agent, warm_agent);
+    ice_agent.gathered->set_on_gathered(on_local_candidates);
+    ice::set_packet_sink(ice_agent, demuxer.as_sink());
+    if(transport) {
+        ensure(ice::add_remote_candidates(ice_agent, *transport));
+    }
     unwrap_mut(local_cred, ice::get_local_credentials(ice_agent));
 
     session = JingleSession{
         .initiate_jingle               = std::move(jingle),
         .ice_agent                     = std::move(ice_agent),
         .local_cred                    = std::move(local_cred),
-        .fingerprint_str               = std::move(fingerprint_str),
-        .dtls_cert_pem                 = std::move(cert_pem),
-        .dtls_priv_key_pem             = std::move(priv_key_pem),
+        .fingerprint_str               = std::move(cert.fingerprint_str),
+        .dtls_cert_pem                 = std::move(cert.cert_pem),
+        .dtls_priv_key_pem             = std::move(cert.priv_key_pem),
         .codecs                        = std::move(codecs),
-        .ssrc_map                      = std::move(ssrc_map),
         .audio_ssrc                    = audio_ssrc,
         .video_ssrc                    = video_ssrc,
         .video_rtx_ssrc                = video_rtx_ssrc,
@@ -346,6 +402,16 @@ auto JingleHandler::on_initiate(jingle::Jingle jingle) -> bool {
         .audio_hdrext_ssrc_audio_level = audio_hdrext_ssrc_audio_level,
     };
 
+    if(reader == nullptr) {
+        // the mainloop thread holds no table between two dispatches, report that after a table is retired
+        reader = ssrc_table.add_reader([this, context = session.ice_agent.mainloop.get_context()]() -> void {
+            ice::post_task(context, [this]() -> void {
+                ssrc_table.quiescent(*reader);
+                ssrc_table.reclaim();
+            });
+        });
+    }
+
     // session initiation half-done
     // wakeup mainthread to create pipeline
     sync->notify();
@@ -354,41 +420,119 @@ auto JingleHandler::on_initiate(jingle::Jingle jingle) -> bool {
 }
 
 auto JingleHandler::on_add_source(jingle::Jingle jingle) -> bool {
-    for(const auto& c : jingle.content) {
-        for(const auto& desc : c.description) {
-            if(!desc.media) {
-                continue;
-            }
-            const auto& media = desc.media.value();
-            auto        type  = SourceType();
-            if(media == "audio") {
-                type = SourceType::Audio;
-            } else if(media == "video") {
-                type = SourceType::Video;
-            } else {
-                LOG_WARN(logger, "unknown media {}", media);
-                continue;
+    // publish all sources of the action at once
+    const auto previous = collect_participants(*ssrc_table.load());
+    ssrc_table.update([this, &jingle](SSRCTable& table) -> void {
+        for(const auto& c : jingle.content) {
+            for(const auto& desc : c.description) {
+                if(!desc.media) {
+                    continue;
+                }
+                const auto& media = desc.media.value();
+                auto        type  = SourceType();
+                if(media == "audio") {
+                    type = SourceType::Audio;
+                } else if(media == "video") {
+                    type = SourceType::Video;
+                } else {
+                    LOG_WARN(logger, "unknown media {}", media);
+                    continue;
+                }
+                for(const auto& src : desc.source) {
+                    table.insert(Source{
+                        .ssrc        = src.ssrc,
+                        .type        = type,
+                        .participant = participants->intern(src.ssrc_info[0].owner),
+                    });
+                }
             }
-            for(const auto& src : desc.source) {
-                session.ssrc_map.insert(std::make_pair(src.ssrc, Source{
-                                                                     .ssrc           = src.ssrc,
-                                                                     .type           = type,
-                                                                     .participant_id = src.ssrc_info[0].owner,
-                                                                 }));
+        }
+    });
+    move_source_refs(previous);
+    return true;
+}
+
+auto JingleHandler::on_remove_source(jingle::Jingle jingle) -> bool {
+    const auto previous = collect_participants(*ssrc_table.load());
+    ssrc_table.update([&jingle](SSRCTable& table) -> void {
+        for(const auto& c : jingle.content) {
+            for(const auto& desc : c.description) {
+                for(const auto& src : desc.source) {
+                    if(!table.erase(src.ssrc)) {
+                        LOG_WARN(logger, "unknown ssrc {} removed", src.ssrc);
+                    }
+                }
             }
         }
-    }
+    });
+    move_source_refs(previous);
     return true;
 }
 
-JingleHandler::JingleHandler(const CodecType                audio_codec_type,
-                             const CodecType                video_codec_type,
-                             xmpp::Jid                      jid,
-                             std::span<const xmpp::Service> external_services,
-                             coop::SingleEvent* const       sync)
+auto JingleHandler::move_source_refs(const std::span<const conference::ParticipantHandle> previous) -> void {
+    // retain first, a participant in both tables must not be recycled in between
+    ssrc_table.load()->for_each([this](const Source& source) -> void { participants->retain(source.participant); });
+    for(const auto handle : previous) {
+        participants->release(handle);
+    }
+}
+
+auto JingleHandler::set_join_trace(trace::JoinTrace* const trace) -> void {
+    join_trace = trace;
+}
+
+auto JingleHandler::set_external_services(const std::span<const xmpp::Service> services) -> void {
+    external_services = services;
+}
+
+auto JingleHandler::set_cert_pool(cert::Pool* const pool) -> void {
+    cert_pool = pool;
+}
+
+auto JingleHandler::set_mainloop_pool(ice::MainloopPool* const pool) -> void {
+    mainloop_pool = pool;
+}
+
+auto JingleHandler::set_agent_pool(ice::AgentPool* const pool) -> void {
+    agent_pool = pool;
+}
+
+auto JingleHandler::set_media_handlers(demux::MediaHandler on_rtp, demux::MediaHandler on_rtcp) -> void {
+    demuxer.on_rtp  = std::move(on_rtp);
+    demuxer.on_rtcp = std::move(on_rtcp);
+}
+
+auto JingleHandler::set_packet_sink(ice::PacketSink sink) -> void {
+    demuxer.on_dtls         = sink;
+    demuxer.on_unknown_ssrc = std::move(sink);
+}
+
+auto JingleHandler::set_trickle_handler(std::function<void()> handler) -> void {
+    on_local_candidates = std::move(handler);
+}
+
+JingleHandler::JingleHandler(const CodecType                        audio_codec_type,
+                             const CodecType                        video_codec_type,
+                             xmpp::Jid                              jid,
+                             std::span<const xmpp::Service>         external_services,
+                             conference::ParticipantRegistry* const participants,
+                             coop::SingleEvent* const               sync)
     : sync(sync),
+      participants(participants),
       audio_codec_type(audio_codec_type),
       video_codec_type(video_codec_type),
       jid(std::move(jid)),
-      external_services(external_services) {
+      external_services(external_services),
+      demuxer{.ssrc_table = &ssrc_table} {
+}
+
+JingleHandler::~JingleHandler() {
+    // the demuxer and the reader must outlive a packet which is being fed on the mainloop thread
+    // this also flushes the quiescent tasks posted before, this thread is the only writer so no more are posted
+    if(session.ice_agent.agent) {
+        ice::clear_packet_sink(session.ice_agent);
+    }
+    if(reader != nullptr) {
+        ssrc_table.remove_reader(reader);
+    }
 }
@@ -1,13 +1,18 @@
 #pragma once
 #include <span>
-#include <unordered_map>
 
 #include <coop/single-event.hpp>
 
 #include "../codec-type.hpp"
+#include "../join-trace.hpp"
+#include "../participant-registry.hpp"
 #include "../xmpp/extdisco.hpp"
 #include "../xmpp/jid.hpp"
+#include "agent-pool.hpp"
+#include "cert-pool.hpp"
+#include "demux.hpp"
 #include "ice.hpp"
+#include "ssrc-table.hpp"
 
 struct Codec {
     CodecType type;
@@ -20,19 +25,6 @@ struct Codec {
 constexpr auto rtp_hdrext_ssrc_audio_level_uri = "urn:ietf:params:rtp-hdrext:ssrc-audio-level";
 constexpr auto rtp_hdrext_transport_cc_uri     = "http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01";
 
-enum class SourceType {
-    Audio,
-    Video,
-};
-
-struct Source {
-    uint32_t    ssrc;
-    SourceType  type;
-    std::string participant_id;
-};
-
-using SSRCMap = std::unordered_map<uint32_t, Source>;
-
 struct JingleSession {
     jingle::Jingle       initiate_jingle;
     ice::Agent           ice_agent;
@@ -41,13 +33,13 @@ struct JingleSession {
     std::string          dtls_cert_pem;
     std::string          dtls_priv_key_pem;
     std::vector<Codec>   codecs;
-    SSRCMap              ssrc_map;
     uint32_t             audio_ssrc;
     uint32_t             video_ssrc;
     uint32_t             video_rtx_ssrc;
     int                  video_hdrext_transport_cc     = -1;
     int                  audio_hdrext_transport_cc     = -1;
     int                  audio_hdrext_ssrc_audio_level = -1;
+    bool                 accepted                      = false; // later local candidates go to transport-info
 
     auto find_codec_by_type(CodecType type) const -> const Codec*;
     auto find_codec_by_tx_pt(int tx_pt) const -> const Codec*;
@@ -55,22 +47,63 @@ struct JingleSession {
 
 class JingleHandler {
   private:
-    coop::SingleEvent*             sync;
-    CodecType                      audio_codec_type;
-    CodecType                      video_codec_type;
-    xmpp::Jid                      jid;
-    std::span<const xmpp::Service> external_services;
-    JingleSession                  session;
+    coop::SingleEvent*               sync;
+    conference::ParticipantRegistry* participants;
+    CodecType                        audio_codec_type;
+    CodecType                        video_codec_type;
+    xmpp::Jid                        jid;
+    std::span<const xmpp::Service>   external_services;
+    SharedSSRCTable                  ssrc_table; // outlives the agent in session
+    demux::Demuxer                   demuxer;    // same as above, reads ssrc_table on the mainloop thread
+    JingleSession                    session;
+    // the mainloop thread, registered once the agent exists
+    SharedSSRCTable::Reader*         reader        = nullptr;
+    trace::JoinTrace*                join_trace    = nullptr;
+    cert::Pool*                      cert_pool     = nullptr;
+    ice::MainloopPool*               mainloop_pool = nullptr;
+    ice::AgentPool*                  agent_pool    = nullptr;
+    std::function<void()>            on_local_candidates;
+
+    // the published table refers to participants by handle, moves the references from the previous one
+    auto move_source_refs(std::span<const conference::ParticipantHandle> previous) -> void;
 
   public:
     auto get_session() const -> const JingleSession&;
-    auto build_accept_jingle() const -> std::optional<jingle::Jingle>;
+    // readers on other threads register a SharedSSRCTable::Reader
+    auto get_ssrc_table() -> SharedSSRCTable&;
+    // takes the local candidates gathered so far
+    auto build_accept_jingle() -> std::optional<jingle::Jingle>;
+    // candidates gathered after the accept, nullopt if there is nothing to send
+    auto build_transport_info() -> std::optional<jingle::Jingle>;
     auto on_initiate(jingle::Jingle jingle) -> bool;
     auto on_add_source(jingle::Jingle jingle) -> bool;
+    auto on_remove_source(jingle::Jingle jingle) -> bool;
+    auto on_transport_info(jingle::Jingle jingle) -> bool;
+    // records cert generation and ice gathering
+    auto set_join_trace(trace::JoinTrace* trace) -> void;
+    // for handlers created before extdisco finishes
+    auto set_external_services(std::span<const xmpp::Service> services) -> void;
+    // certificates are generated in on_initiate without a pool
+    auto set_cert_pool(cert::Pool* pool) -> void;
+    // agents share ice::MainloopPool::get() without a pool
+    auto set_mainloop_pool(ice::MainloopPool* pool) -> void;
+    // on_initiate takes a pre-gathered agent from the pool if there is one
+    auto set_agent_pool(ice::AgentPool* pool) -> void;
+    // called on a mainloop thread when local candidates are gathered, set before on_initiate
+    // the handler should call build_transport_info on the conference thread
+    auto set_trickle_handler(std::function<void()> handler) -> void;
+    // receives rtp and rtcp of known sources routed by ssrc, set before on_initiate
+    // called on the mainloop thread
+    auto set_media_handlers(demux::MediaHandler on_rtp, demux::MediaHandler on_rtcp) -> void;
+    // receives dtls and media of unknown sources, set before on_initiate
+    // use an ice::PacketRing sink to consume on another thread
+    auto set_packet_sink(ice::PacketSink sink) -> void;
 
-    JingleHandler(CodecType                      audio_codec_type,
-                  CodecType                      video_codec_type,
-                  xmpp::Jid                      jid,
-                  std::span<const xmpp::Service> external_services,
-                  coop::SingleEvent*             sync);
+    JingleHandler(CodecType                        audio_codec_type,
+                  CodecType                        video_codec_type,
+                  xmpp::Jid                        jid,
+                  std::span<const xmpp::Service>   external_services,
+                  conference::ParticipantRegistry* participants,
+                  coop::SingleEvent*               sync);
+    ~JingleHandler();
 };
@@ -0,0 +1,162 @@
+#include <bit>
+#include <future>
+#include <utility>
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+#include "../macros/logger.hpp"
+#include "../util/assert.hpp"
+#include "mainloop-pool.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "../macros/unwrap.hpp"
+
+namespace ice {
+namespace {
+auto logger = Logger("ice");
+
+auto pin_to_cpu(std::thread& thread, const size_t index) -> void {
+#if defined(__linux__)
+    const auto cpu_count = std::max(1u, std::thread::hardware_concurrency());
+    auto       cpus      = cpu_set_t();
+    CPU_ZERO(&cpus);
+    CPU_SET(index % cpu_count, &cpus);
+    if(pthread_setaffinity_np(thread.native_handle(), sizeof(cpus), &cpus) != 0) {
+        LOG_WARN(logger, "failed to pin mainloop {} to cpu", index);
+    }
+#else
+    (void)thread;
+    LOG_WARN(logger, "cpu pinning is not supported on this platform, mainloop {}", index);
+#endif
+}
+
+auto quit_mainloop(const gpointer data) -> gboolean {
+    g_main_loop_quit(std::bit_cast<GMainLoop*>(data));
+    return G_SOURCE_REMOVE;
+}
+
+auto run_posted_task(const gpointer data) -> gboolean {
+    (*std::bit_cast<std::function<void()>*>(data))();
+    return G_SOURCE_REMOVE;
+}
+
+auto free_posted_task(const gpointer data) -> void {
+    delete std::bit_cast<std::function<void()>*>(data);
+}
+} // namespace
+
+auto Mainloop::get_context() -> GMainContext* {
+    return g_main_loop_get_context(mainloop.get());
+}
+
+auto MainloopLease::get_context() const -> GMainContext* {
+    return mainloop->get_context();
+}
+
+MainloopLease::MainloopLease(Mainloop* const mainloop)
+    : mainloop(mainloop) {
+    mainloop->agents.fetch_add(1);
+}
+
+MainloopLease::MainloopLease(MainloopLease&& o)
+    : mainloop(std::exchange(o.mainloop, nullptr)) {
+}
+
+auto MainloopLease::operator=(MainloopLease&& o) -> MainloopLease& {
+    if(this != &o) {
+        if(mainloop != nullptr) {
+            mainloop->agents.fetch_sub(1);
+        }
+        mainloop = std::exchange(o.mainloop, nullptr);
+    }
+    return *this;
+}
+
+MainloopLease::~MainloopLease() {
+    if(mainloop != nullptr) {
+        mainloop->agents.fetch_sub(1);
+    }
+}
+
+auto MainloopPool::acquire() -> MainloopLease {
+    if(config.assignment == MainloopPoolConfig::Assignment::RoundRobin) {
+        return MainloopLease(mainloops[next.fetch_add(1) % mainloops.size()].get());
+    }
+    auto best = mainloops[0].get();
+    for(const auto& mainloop : mainloops) {
+        if(mainloop->agents.load() < best->agents.load()) {
+            best = mainloop.get();
+        }
+    }
+    return MainloopLease(best);
+}
+
+auto MainloopPool::create(MainloopPoolConfig config) -> std::unique_ptr<MainloopPool> {
+    config.thread_count = std::max(config.thread_count, 1uz);
+
+    auto pool    = std::unique_ptr<MainloopPool>(new MainloopPool());
+    pool->config = config;
+    for(auto i = 0uz; i < config.thread_count; i += 1) {
+        // each mainloop gets its own context, the default one belongs to the application
+        const auto context = g_main_context_new();
+        ensure(context != NULL, "failed to create main context");
+        const auto mainloop = g_main_loop_new(context, FALSE);
+        g_main_context_unref(context);
+        ensure(mainloop != NULL, "failed to create mainloop");
+
+        auto& ml    = *pool->mainloops.emplace_back(new Mainloop());
+        ml.mainloop = AutoGMainLoop(mainloop);
+        ml.index    = i;
+        ml.runner   = std::thread(g_main_loop_run, mainloop);
+        if(config.pin_cpu) {
+            pin_to_cpu(ml.runner, i);
+        }
+    }
+    LOG_DEBUG(logger, "started {} mainloops", config.thread_count);
+    return pool;
+}
+
+auto MainloopPool::get() -> MainloopPool& {
+    static const auto pool = create();
+    if(!pool) {
+        PANIC("failed to create the default mainloop pool");
+    }
+    return *pool;
+}
+
+MainloopPool::~MainloopPool() {
+    for(const auto& mainloop : mainloops) {
+        // quit from inside the loop, g_main_loop_quit is lost if the runner has not entered g_main_loop_run yet
+        const auto source = g_idle_source_new();
+        g_source_set_callback(source, quit_mainloop, mainloop->mainloop.get(), NULL);
+        g_source_attach(source, mainloop->get_context());
+        g_source_unref(source);
+    }
+    for(const auto& mainloop : mainloops) {
+        if(mainloop->runner.joinable()) {
+            mainloop->runner.join();
+        }
+    }
+}
+
+auto post_task(GMainContext* const context, std::function<void()> task) -> void {
+    // an idle source never runs inline, unlike g_main_context_invoke
+    // sources of the same priority are dispatched in the order they were attached
+    const auto source = g_idle_source_new();
+    g_source_set_priority(source, G_PRIORITY_DEFAULT);
+    g_source_set_callback(source, run_posted_task, new std::function<void()>(std::move(task)), free_posted_task);
+    g_source_attach(source, context);
+    g_source_unref(source);
+}
+
+auto run_task(GMainContext* const context, std::function<void()> task) -> void {
+    auto done = std::promise<void>();
+    post_task(context, [&task, &done]() -> void {
+        task();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+} // namespace ice
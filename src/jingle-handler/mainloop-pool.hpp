@@ -0,0 +1,72 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <glib.h>
+
+#include "../macros/autoptr.hpp"
+
+namespace ice {
+declare_autoptr(GMainLoop, GMainLoop, g_main_loop_unref);
+
+struct MainloopPoolConfig {
+    enum class Assignment {
+        LeastLoaded,
+        RoundRobin,
+    };
+
+    size_t     thread_count = 1;
+    Assignment assignment   = Assignment::LeastLoaded;
+    // pin thread n to cpu n % hardware_concurrency, linux only
+    bool pin_cpu = false;
+};
+
+// one glib main context with its own thread
+struct Mainloop {
+    AutoGMainLoop   mainloop;
+    std::thread     runner;
+    std::atomic_int agents = 0;
+    size_t          index;
+
+    auto get_context() -> GMainContext*;
+};
+
+// keeps the assigned mainloop counted while an agent lives on it
+struct MainloopLease {
+    Mainloop* mainloop = nullptr;
+
+    auto get_context() const -> GMainContext*;
+
+    MainloopLease() = default;
+    MainloopLease(Mainloop* mainloop);
+    MainloopLease(MainloopLease&& o);
+    auto operator=(MainloopLease&& o) -> MainloopLease&;
+    ~MainloopLease();
+};
+
+// nice agents of many sessions share a fixed number of mainloop threads
+// the threads are joined only when the pool is destroyed
+struct MainloopPool {
+    MainloopPoolConfig                     config;
+    std::vector<std::unique_ptr<Mainloop>> mainloops;
+    std::atomic_size_t                     next = 0;
+
+    // thread safe
+    auto acquire() -> MainloopLease;
+
+    static auto create(MainloopPoolConfig config = {}) -> std::unique_ptr<MainloopPool>;
+    // process-wide pool with the default config, created on first use
+    // aborts if the pool cannot be created
+    static auto get() -> MainloopPool&;
+
+    ~MainloopPool();
+};
+
+// runs task on the thread of context, tasks posted to the same context run in the order they were posted
+auto post_task(GMainContext* context, std::function<void()> task) -> void;
+// post_task and waits until the task has finished, must not be called on the thread of context
+auto run_task(GMainContext* context, std::function<void()> task) -> void;
+} // namespace ice
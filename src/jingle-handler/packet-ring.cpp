@@ -0,0 +1,56 @@
+#include <bit>
+#include <cstring>
+
+#include "packet-ring.hpp"
+
+namespace ice {
+auto PacketRing::push(const std::span<const std::byte> data, const PacketInfo& info) -> bool {
+    if(data.size() > slot_size) {
+        oversized.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    const auto h = head.load(std::memory_order_relaxed);
+    if(h - tail.load(std::memory_order_acquire) > mask) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    auto& slot = slots[h & mask];
+    std::memcpy(slot.data, data.data(), data.size());
+    slot.info = info;
+    head.store(h + 1, std::memory_order_release);
+    pushed.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+auto PacketRing::as_sink() -> PacketSink {
+    return [this](const std::span<const std::byte> data, const PacketInfo& info) -> void {
+        push(data, info);
+    };
+}
+
+auto PacketRing::front() -> const Packet* {
+    const auto t = tail.load(std::memory_order_relaxed);
+    if(t == head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &slots[t & mask];
+}
+
+auto PacketRing::pop() -> void {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+auto PacketRing::create(const size_t capacity, const size_t slot_size) -> std::unique_ptr<PacketRing> {
+    const auto count = std::bit_ceil(std::max(capacity, 2uz));
+
+    auto ring       = std::unique_ptr<PacketRing>(new PacketRing());
+    ring->buffer    = std::make_unique<std::byte[]>(count * slot_size);
+    ring->slots     = std::make_unique<Packet[]>(count);
+    ring->slot_size = slot_size;
+    ring->mask      = count - 1;
+    for(auto i = 0uz; i < count; i += 1) {
+        ring->slots[i].data = ring->buffer.get() + i * slot_size;
+    }
+    return ring;
+}
+} // namespace ice
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <span>
+
+namespace ice {
+struct PacketInfo {
+    std::chrono::steady_clock::time_point arrival;
+    size_t                                len;
+};
+
+// receives every datagram on the mainloop thread
+// data points into the receive buffer of libnice and is valid only during the call
+using PacketSink = std::function<void(std::span<const std::byte> data, const PacketInfo& info)>;
+
+struct Packet {
+    PacketInfo info;
+    std::byte* data; // slot_size bytes, info.len of them valid
+
+    auto get_data() const -> std::span<const std::byte> {
+        return {data, info.len};
+    }
+};
+
+// single producer single consumer ring of preallocated packet buffers
+// for consumers running on another thread than the mainloop
+// the producer copies each datagram once into a free slot, nothing is allocated per packet
+struct PacketRing {
+    // keep the indices of both sides on separate cache lines
+    static constexpr auto cache_line = size_t(64);
+
+    std::unique_ptr<std::byte[]> buffer;
+    std::unique_ptr<Packet[]>    slots;
+    size_t                       slot_size;
+    size_t                       mask;
+
+    alignas(cache_line) std::atomic_size_t head = 0; // written by the producer
+    // statistics, written by the producer
+    std::atomic_uint64_t pushed    = 0;
+    std::atomic_uint64_t dropped   = 0; // the ring was full
+    std::atomic_uint64_t oversized = 0; // longer than slot_size
+
+    alignas(cache_line) std::atomic_size_t tail = 0; // written by the consumer
+
+    // producer side, false if the packet was dropped
+    auto push(std::span<const std::byte> data, const PacketInfo& info) -> bool;
+    // sink which pushes to this ring, the ring must outlive it
+    auto as_sink() -> PacketSink;
+
+    // consumer side, nullptr if empty
+    // the packet stays valid until pop
+    auto front() -> const Packet*;
+    auto pop() -> void;
+
+    // capacity is rounded up to a power of two
+    static auto create(size_t capacity = 1024, size_t slot_size = 1500) -> std::unique_ptr<PacketRing>;
+};
+} // namespace ice
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <utility>
+
+#include "ssrc-table.hpp"
+
+namespace {
+constexpr auto initial_capacity = 16uz;
+} // namespace
+
+auto SSRCTable::get_home(const uint32_t ssrc) const -> size_t {
+    // fibonacci hashing, the top bits are well mixed
+    return uint32_t(ssrc * 0x9E3779B1u) >> shift;
+}
+
+auto SSRCTable::find(const uint32_t ssrc) const -> const Source* {
+    if(count == 0) {
+        return nullptr;
+    }
+    const auto mask = slots.size() - 1;
+    for(auto i = get_home(ssrc);; i = (i + 1) & mask) {
+        const auto& slot = slots[i];
+        if(!slot.used) {
+            return nullptr;
+        }
+        if(slot.source.ssrc == ssrc) {
+            return &slot.source;
+        }
+    }
+}
+
+auto SSRCTable::insert(const Source& source) -> void {
+    // keep the load factor at or below 1/2
+    if((count + 1) * 2 > slots.size()) {
+        rehash(std::max(initial_capacity, slots.size() * 2));
+    }
+    const auto mask = slots.size() - 1;
+    for(auto i = get_home(source.ssrc);; i = (i + 1) & mask) {
+        auto& slot = slots[i];
+        if(!slot.used) {
+            slot  = Slot{.source = source, .used = true};
+            count += 1;
+            return;
+        }
+        if(slot.source.ssrc == source.ssrc) {
+            slot.source = source;
+            return;
+        }
+    }
+}
+
+auto SSRCTable::erase(const uint32_t ssrc) -> bool {
+    if(count == 0) {
+        return false;
+    }
+    const auto mask = slots.size() - 1;
+    auto       hole = get_home(ssrc);
+    while(true) {
+        if(!slots[hole].used) {
+            return false;
+        }
+        if(slots[hole].source.ssrc == ssrc) {
+            break;
+        }
+        hole = (hole + 1) & mask;
+    }
+    // move back followers whose home is not between the hole and their position
+    for(auto i = (hole + 1) & mask; slots[i].used; i = (i + 1) & mask) {
+        const auto home = get_home(slots[i].source.ssrc);
+        if(((i - home) & mask) >= ((i - hole) & mask)) {
+            slots[hole] = slots[i];
+            hole        = i;
+        }
+    }
+    slots[hole].used = false;
+    count -= 1;
+    return true;
+}
+
+auto SSRCTable::rehash(const size_t capacity) -> void {
+    auto old = std::exchange(slots, std::vector<Slot>(capacity));
+    shift    = 32 - std::countr_zero(capacity);
+    count    = 0;
+    for(const auto& slot : old) {
+        if(slot.used) {
+            insert(slot.source);
+        }
+    }
+}
+
+auto SharedSSRCTable::add_reader(std::function<void()> wake) -> Reader* {
+    auto lock   = std::lock_guard(mutex);
+    auto reader = new Reader{.seen = epoch.load(), .wake = std::move(wake)};
+    readers.emplace_back(reader);
+    return reader;
+}
+
+auto SharedSSRCTable::remove_reader(Reader* const reader) -> void {
+    auto lock = std::lock_guard(mutex);
+    std::erase_if(readers, [reader](const std::unique_ptr<Reader>& r) -> bool { return r.get() == reader; });
+    // the removed reader may have been the last one holding a table back
+    reclaim_locked();
+}
+
+auto SharedSSRCTable::publish(SSRCTable table) -> void {
+    auto lock = std::lock_guard(mutex);
+    publish_locked(std::move(table));
+}
+
+auto SharedSSRCTable::publish_locked(SSRCTable table) -> void {
+    auto next = std::make_unique<const SSRCTable>(std::move(table));
+    current.store(next.get(), std::memory_order_release);
+    // readers which report this epoch or later can no longer see the old table
+    const auto retired_epoch = epoch.fetch_add(1) + 1;
+    retired.push_back(Retired{.table = std::exchange(owned, std::move(next)), .epoch = retired_epoch});
+    reclaim_locked();
+    // idle readers would hold the retired tables back until their next quiescent state, let them report one
+    if(!retired.empty()) {
+        for(const auto& reader : readers) {
+            if(reader->wake) {
+                reader->wake();
+            }
+        }
+    }
+}
+
+auto SharedSSRCTable::reclaim() -> void {
+    auto lock = std::lock_guard(mutex);
+    reclaim_locked();
+}
+
+auto SharedSSRCTable::reclaim_locked() -> void {
+    auto oldest = std::numeric_limits<uint64_t>::max();
+    for(const auto& reader : readers) {
+        oldest = std::min(oldest, reader->seen.load());
+    }
+    std::erase_if(retired, [oldest](const Retired& r) -> bool { return r.epoch <= oldest; });
+}
+
+SharedSSRCTable::SharedSSRCTable()
+    : owned(std::make_unique<const SSRCTable>()) {
+    current.store(owned.get());
+}
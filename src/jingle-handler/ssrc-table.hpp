@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../participant-registry.hpp"
+
+enum class SourceType : uint8_t {
+    Audio,
+    Video,
+};
+
+struct Source {
+    uint32_t                      ssrc;
+    SourceType                    type;
+    conference::ParticipantHandle participant; // ssrc owner, interned in the conference's registry and retained by JingleHandler
+};
+
+// open addressing table keyed by ssrc, linear probing with backward shift deletion
+// a lookup touches one or two cache lines and never allocates
+struct SSRCTable {
+    struct Slot {
+        Source source;
+        bool   used = false;
+    };
+
+    std::vector<Slot> slots;
+    uint32_t          shift = 32;
+    size_t            count = 0;
+
+    auto find(uint32_t ssrc) const -> const Source*;
+    // replaces an existing source with the same ssrc
+    auto insert(const Source& source) -> void;
+    auto erase(uint32_t ssrc) -> bool;
+
+    auto size() const -> size_t {
+        return count;
+    }
+
+    template <class F>
+    auto for_each(F f) const -> void {
+        for(const auto& slot : slots) {
+            if(slot.used) {
+                f(slot.source);
+            }
+        }
+    }
+
+  private:
+    auto get_home(uint32_t ssrc) const -> size_t;
+    auto rehash(size_t capacity) -> void;
+};
+
+// read-mostly ssrc table shared with the mainloop threads, rcu with quiescent state based reclamation
+// writers copy the current table, modify the copy and publish it, the old one is retired
+// readers look up with a single pointer load, and report a quiescent state now and then while they hold no table
+// a retired table is freed once every reader has reported a quiescent state after it was retired
+struct SharedSSRCTable {
+    struct Reader {
+        std::atomic_uint64_t  seen; // epoch observed at the last quiescent state
+        std::function<void()> wake; // optional, asks the reader's thread to call quiescent soon
+    };
+
+    struct Retired {
+        std::unique_ptr<const SSRCTable> table;
+        uint64_t                         epoch; // freed when every reader has seen this
+    };
+
+    std::atomic<const SSRCTable*> current;
+    std::atomic_uint64_t          epoch = 0;
+    // below are for writers and reader registration
+    std::mutex                           mutex;
+    std::unique_ptr<const SSRCTable>     owned; // what current points to
+    std::vector<Retired>                 retired;
+    std::vector<std::unique_ptr<Reader>> readers;
+
+    // reader side, wait-free
+    // the table stays valid until the reader calls quiescent
+    auto load() const -> const SSRCTable* {
+        return current.load(std::memory_order_acquire);
+    }
+
+    // e.g. once per mainloop iteration, not per lookup
+    auto quiescent(Reader& reader) const -> void {
+        reader.seen.store(epoch.load());
+    }
+
+    // the reader must be quiescent when registered and removed
+    // wake is called with the writer lock held after a table is retired, it must not block or call back into the table
+    auto add_reader(std::function<void()> wake = {}) -> Reader*;
+    auto remove_reader(Reader* reader) -> void;
+
+    // writer side, thread safe, never waits for readers
+    auto publish(SSRCTable table) -> void;
+
+    template <class F>
+    auto update(F f) -> void {
+        auto lock = std::lock_guard(mutex);
+        auto next = *owned;
+        f(next);
+        publish_locked(std::move(next));
+    }
+
+    // frees the retired tables every reader has passed, thread safe
+    // readers call this after quiescent to free a table without waiting for the next publish
+    auto reclaim() -> void;
+
+    SharedSSRCTable();
+
+  private:
+    auto publish_locked(SSRCTable table) -> void;
+    auto reclaim_locked() -> void;
+};
@@ -106,6 +106,11 @@ auto parse(const xml::Node& node) -> std::optional<Jingle> {
     return std::move(parsed);
 }
 
+auto parse(const xmlview::Node& node) -> std::optional<Jingle> {
+    // serde only speaks xml::Node, materialize just the jingle subtree
+    return parse(node.to_node());
+}
+
 auto deparse(const Jingle& jingle) -> std::optional<xml::Node> {
     unwrap_mut(node, jingle.dump<serde::XmlFormat>());
     node.name = "jingle";
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 
+#include "../xml-view.hpp"
 #include "../xml/xml.hpp"
 #include "serde/serde.hpp"
 
@@ -256,5 +257,6 @@ struct Jingle {
 };
 
 auto parse(const xml::Node& node) -> std::optional<Jingle>;
+auto parse(const xmlview::Node& node) -> std::optional<Jingle>;
 auto deparse(const Jingle& jingle) -> std::optional<xml::Node>;
 } // namespace jingle
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <format>
+#include <iterator>
+
+#include "join-trace.hpp"
+
+namespace trace {
+namespace {
+auto to_us(const JoinTrace::Clock::duration duration) -> int64_t {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+}
+} // namespace
+
+auto phase_to_str(const Phase phase) -> std::string_view {
+    switch(phase) {
+    case Phase::WebsocketConnect:
+        return "websocket-connect";
+    case Phase::StreamOpen:
+        return "stream-open";
+    case Phase::Auth:
+        return "auth";
+    case Phase::Bind:
+        return "bind";
+    case Phase::StreamManagement:
+        return "stream-management";
+    case Phase::Disco:
+        return "disco";
+    case Phase::FocusConference:
+        return "focus-conference";
+    case Phase::Presence:
+        return "presence";
+    case Phase::SessionInitiate:
+        return "session-initiate";
+    case Phase::CertGeneration:
+        return "cert-generation";
+    case Phase::IceGathering:
+        return "ice-gathering";
+    case Phase::Accept:
+        return "accept";
+    case Phase::ColibriConnect:
+        return "colibri-connect";
+    }
+    return "unknown";
+}
+
+auto JoinTrace::begin(const Phase phase) -> void {
+    auto& span = spans[size_t(phase)];
+    if(span.begin == Clock::time_point()) {
+        span.begin = Clock::now();
+    }
+}
+
+auto JoinTrace::end(const Phase phase) -> void {
+    auto& span = spans[size_t(phase)];
+    if(span.begin != Clock::time_point() && span.end == Clock::time_point()) {
+        span.end = Clock::now();
+    }
+}
+
+auto JoinTrace::get_duration(const Phase phase) const -> std::optional<std::chrono::microseconds> {
+    const auto& span = spans[size_t(phase)];
+    if(span.end == Clock::time_point()) {
+        return std::nullopt;
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(span.end - span.begin);
+}
+
+auto JoinTrace::get_total() const -> std::chrono::microseconds {
+    auto last = origin;
+    for(const auto& span : spans) {
+        last = std::max(last, span.end);
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(last - origin);
+}
+
+auto JoinTrace::to_string() const -> std::string {
+    auto str = std::string();
+    for(auto i = 0uz; i < phase_count; i += 1) {
+        const auto& span = spans[i];
+        if(span.end == Clock::time_point()) {
+            continue;
+        }
+        std::format_to(std::back_inserter(str), "{:<18} +{:>8}us {:>8}us\n", phase_to_str(Phase(i)), to_us(span.begin - origin), to_us(span.end - span.begin));
+    }
+    std::format_to(std::back_inserter(str), "{:<18}  {:>8}us\n", "total", get_total().count());
+    return str;
+}
+
+auto JoinTrace::to_chrome_trace(const int pid) const -> std::string {
+    auto str   = std::string(R"({"traceEvents":[)");
+    auto first = true;
+    for(auto i = 0uz; i < phase_count; i += 1) {
+        const auto& span = spans[i];
+        if(span.end == Clock::time_point()) {
+            continue;
+        }
+        // complete events, phases may overlap so each gets its own row
+        std::format_to(std::back_inserter(str), R"({}{{"name":"{}","cat":"join","ph":"X","ts":{},"dur":{},"pid":{},"tid":{}}})",
+                       first ? "" : ",", phase_to_str(Phase(i)), to_us(span.begin - origin), to_us(span.end - span.begin), pid, i);
+        first = false;
+    }
+    str += R"(],"displayTimeUnit":"ms"})";
+    return str;
+}
+} // namespace trace
@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace trace {
+enum class Phase : uint8_t {
+    WebsocketConnect,
+    StreamOpen,
+    Auth,
+    Bind,
+    StreamManagement,
+    Disco,           // disco and extdisco
+    FocusConference, // conference request to the focus
+    Presence,        // join presence until the room reflects it
+    SessionInitiate, // join presence until session-initiate arrives
+    CertGeneration,
+    IceGathering,    // session-initiate until candidate gathering is done
+    Accept,          // session-accept until its result
+    ColibriConnect,
+};
+
+constexpr auto phase_count = size_t(Phase::ColibriConnect) + 1;
+
+auto phase_to_str(Phase phase) -> std::string_view;
+
+// timestamps of each phase of one join, on the monotonic clock
+// each phase is recorded once, later begin/end calls of the same phase are ignored
+// not thread safe, record from the thread which runs the conference
+struct JoinTrace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Span {
+        Clock::time_point begin;
+        Clock::time_point end;
+    };
+
+    Clock::time_point             origin = Clock::now();
+    std::array<Span, phase_count> spans  = {};
+
+    auto begin(Phase phase) -> void;
+    auto end(Phase phase) -> void;
+    // nullopt if the phase was not completed
+    auto get_duration(Phase phase) const -> std::optional<std::chrono::microseconds>;
+    // from origin to the latest end
+    auto get_total() const -> std::chrono::microseconds;
+    // one line per completed phase, offset from origin and duration
+    auto to_string() const -> std::string;
+    // chrome trace event format, can be loaded in chrome://tracing or perfetto
+    auto to_chrome_trace(int pid = 1) const -> std::string;
+};
+
+// for optional traces
+inline auto begin(JoinTrace* const trace, const Phase phase) -> void {
+    if(trace != nullptr) {
+        trace->begin(phase);
+    }
+}
+
+inline auto end(JoinTrace* const trace, const Phase phase) -> void {
+    if(trace != nullptr) {
+        trace->end(phase);
+    }
+}
+} // namespace trace
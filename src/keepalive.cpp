@@ -0,0 +1,61 @@
+#include <algorithm>
+
+#include "keepalive.hpp"
+
+namespace conference {
+auto Keepalive::on_received(const Clock::time_point now) -> void {
+    last_received = now;
+    probes        = 0;
+}
+
+auto Keepalive::on_pong(const Clock::duration rtt) -> void {
+    const auto r = std::chrono::duration_cast<std::chrono::microseconds>(rtt);
+    if(rtt_samples == 0) {
+        srtt   = r;
+        jitter = r / 2;
+    } else {
+        jitter = (jitter * 3 + (srtt > r ? srtt - r : r - srtt)) / 4;
+        srtt   = (srtt * 7 + r) / 8;
+    }
+    rtt_samples += 1;
+}
+
+auto Keepalive::get_probe_timeout() const -> Clock::duration {
+    if(rtt_samples == 0) {
+        return config.min_probe_timeout;
+    }
+    return std::max<Clock::duration>(srtt + jitter * 4, config.min_probe_timeout);
+}
+
+auto Keepalive::get_backoff_timeout() const -> Clock::duration {
+    return get_probe_timeout() * (1 << std::min(probes > 0 ? probes - 1 : 0, 16u));
+}
+
+auto Keepalive::poll(const Clock::time_point now) -> Action {
+    if(now - last_received >= config.dead_timeout) {
+        return Action::Dead;
+    }
+    if(probes == 0) {
+        if(now - last_received < config.idle_interval) {
+            return Action::Wait;
+        }
+    } else {
+        if(now - last_ping < get_backoff_timeout()) {
+            return Action::Wait;
+        }
+        // the outstanding ping timed out
+        if(probes >= config.max_probes) {
+            return Action::Dead;
+        }
+    }
+    last_ping = now;
+    probes += 1;
+    return Action::Ping;
+}
+
+auto Keepalive::get_next_wakeup() const -> Clock::time_point {
+    const auto dead_at = last_received + config.dead_timeout;
+    const auto ping_at = probes > 0 ? last_ping + get_backoff_timeout() : last_received + config.idle_interval;
+    return std::min(dead_at, ping_at);
+}
+} // namespace conference
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+namespace conference {
+struct KeepaliveConfig {
+    // ping once nothing was received for this long
+    std::chrono::milliseconds idle_interval = std::chrono::seconds(10);
+    // the connection is considered dead once nothing was received for this long, whatever the probes say
+    std::chrono::milliseconds dead_timeout = std::chrono::seconds(30);
+    // lower bound of the probe timeout
+    std::chrono::milliseconds min_probe_timeout = std::chrono::seconds(1);
+    // the connection is considered dead once this many pings in a row went unanswered
+    uint32_t max_probes = 3;
+};
+
+// decides when to ping, sans-io
+// any received stanza proves the connection alive, so no pings are sent while traffic flows
+// one ping is outstanding at a time, each retry waits twice as long as the previous one
+// round trip time is smoothed as in rfc6298
+struct Keepalive {
+    using Clock = std::chrono::steady_clock;
+
+    enum class Action {
+        Wait,
+        Ping,
+        Dead,
+    };
+
+    KeepaliveConfig           config;
+    Clock::time_point         last_received;
+    Clock::time_point         last_ping;       // valid while probes is not zero
+    uint32_t                  probes      = 0; // pings sent since nothing was received
+    std::chrono::microseconds srtt        = {};
+    std::chrono::microseconds jitter      = {}; // rttvar of rfc6298
+    uint32_t                  rtt_samples = 0;
+
+    auto on_received(Clock::time_point now) -> void;
+    auto on_pong(Clock::duration rtt) -> void;
+    // srtt + 4 * jitter, clamped to config.min_probe_timeout
+    auto get_probe_timeout() const -> Clock::duration;
+    // probe timeout of the outstanding ping, doubled for each retry
+    auto get_backoff_timeout() const -> Clock::duration;
+    // Ping means the caller has to send a ping now
+    auto poll(Clock::time_point now) -> Action;
+    // when poll should be called again if nothing is received
+    auto get_next_wakeup() const -> Clock::time_point;
+};
+} // namespace conference
@@ -0,0 +1,99 @@
+#include <utility>
+
+#include <coop/thread.hpp>
+
+#include "macros/logger.hpp"
+#include "outbound-queue.hpp"
+
+namespace outbound {
+namespace {
+auto logger = Logger("outbound");
+
+// unregisters a waiter when the waiting coroutine is cancelled
+struct WaiterRegistration {
+    std::vector<coop::SingleEvent*>& waiters;
+    coop::SingleEvent*               event;
+
+    ~WaiterRegistration() {
+        std::erase(waiters, event);
+    }
+};
+
+auto notify_all(std::vector<coop::SingleEvent*>& waiters) -> void {
+    for(const auto event : std::exchange(waiters, {})) {
+        event->notify();
+    }
+}
+} // namespace
+
+auto Queue::push(std::string payload, const Priority priority) -> void {
+    queued_bytes += payload.size();
+    queues[size_t(priority)].emplace_back(std::move(payload));
+    notify_all(data_waiters);
+}
+
+auto Queue::pop() -> std::optional<std::string> {
+    for(auto& queue : queues) {
+        if(queue.empty()) {
+            continue;
+        }
+        auto payload = std::move(queue.front());
+        queue.pop_front();
+        queued_bytes -= payload.size();
+        if(has_capacity()) {
+            notify_all(capacity_waiters);
+        }
+        return payload;
+    }
+    return std::nullopt;
+}
+
+auto Queue::wait_capacity() -> coop::Async<bool> {
+    while(!failed && !has_capacity()) {
+        auto       event        = coop::SingleEvent();
+        const auto registration = WaiterRegistration{capacity_waiters, &event};
+        capacity_waiters.push_back(&event);
+        co_await event;
+    }
+    co_return !failed;
+}
+
+auto Queue::run_sender(std::function<bool(std::string_view)> send) -> coop::Async<void> {
+    this->send = std::move(send);
+loop:
+    auto payload = pop();
+    if(!payload) {
+        auto       event        = coop::SingleEvent();
+        const auto registration = WaiterRegistration{data_waiters, &event};
+        data_waiters.push_back(&event);
+        co_await event;
+        goto loop;
+    }
+    if(stream_manager != nullptr) {
+        stream_manager->on_sent(*payload);
+    }
+    // the payload is owned by this frame, so the queue can be modified while sending
+    auto result = false;
+    co_await coop::run_blocking([&]() { result = this->send(*payload); });
+    if(!result) {
+        LOG_ERROR(logger, "failed to send payload, {} bytes left in queue", queued_bytes);
+        failed = true;
+        notify_all(capacity_waiters);
+        while(failed) {
+            auto       event        = coop::SingleEvent();
+            const auto registration = WaiterRegistration{recover_waiters, &event};
+            recover_waiters.push_back(&event);
+            co_await event;
+        }
+        goto loop;
+    }
+    sent_bytes += payload->size();
+    goto loop;
+}
+
+auto Queue::recover(std::function<bool(std::string_view)> send) -> void {
+    this->send = std::move(send);
+    failed     = false;
+    notify_all(recover_waiters);
+}
+} // namespace outbound
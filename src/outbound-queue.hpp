@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <coop/generator.hpp>
+#include <coop/single-event.hpp>
+
+#include "xmpp/stream-manager.hpp"
+
+namespace outbound {
+enum class Priority : uint8_t {
+    High,   // replies the peer is waiting for, e.g. iq results and jingle accept
+    Normal, // requests
+    Low,    // presence updates
+};
+
+constexpr auto priority_count = 3;
+
+// serialized stanzas waiting for the socket, sent in priority order and fifo within a priority
+// push never blocks, since the sans-io conference worker cannot wait
+// instead, coop based producers co_await wait_capacity() before producing more,
+// e.g. before feeding the next received frame to the conference
+struct Queue {
+    std::array<std::deque<std::string>, priority_count> queues;
+    size_t                                              byte_budget  = 256 * 1024;
+    size_t                                              queued_bytes = 0;
+    size_t                                              sent_bytes   = 0;
+    bool                                                failed       = false; // set when send failed, sending stops until recover
+    std::function<bool(std::string_view)>               send;
+    std::vector<coop::SingleEvent*>                     capacity_waiters;
+    std::vector<coop::SingleEvent*>                     data_waiters;
+    std::vector<coop::SingleEvent*>                     recover_waiters;
+    xmpp::StreamManager*                                stream_manager = nullptr; // optional, told about payloads in wire order
+
+    auto push(std::string payload, Priority priority) -> void;
+    auto pop() -> std::optional<std::string>;
+
+    auto has_capacity() const -> bool {
+        return queued_bytes < byte_budget;
+    }
+
+    // returns false if the queue failed
+    auto wait_capacity() -> coop::Async<bool>;
+    // sends queued payloads until cancelled, send is called in a blocking thread
+    // after a failure it waits for recover, payloads pushed meanwhile are kept
+    auto run_sender(std::function<bool(std::string_view)> send) -> coop::Async<void>;
+    // resumes sending through send, e.g. after the stream is resumed on a new connection
+    // call this after the resumption finished, so that payloads resent by the stream manager go out before the queued ones
+    // the payload which failed was already passed to on_sent, the stream manager resends it if there is one
+    auto recover(std::function<bool(std::string_view)> send) -> void;
+};
+} // namespace outbound
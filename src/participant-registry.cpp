@@ -0,0 +1,81 @@
+#include "participant-registry.hpp"
+
+namespace conference {
+auto ParticipantRegistry::intern(const std::string_view id) -> ParticipantHandle {
+    if(const auto i = index.find(id); i != index.end()) {
+        return i->second;
+    }
+    if(!free_handles.empty()) {
+        const auto handle = free_handles.back();
+        free_handles.pop_back();
+        auto& entry = entries[handle];
+        entry.id    = id;
+        index.emplace(entry.id, handle);
+        return handle;
+    }
+    const auto  handle = ParticipantHandle(entries.size());
+    const auto& entry  = entries.emplace_back(Entry{.id = std::string(id)});
+    flags.push_back(0);
+    index.emplace(entry.id, handle);
+    return handle;
+}
+
+auto ParticipantRegistry::find(const std::string_view id) const -> ParticipantHandle {
+    const auto i = index.find(id);
+    return i != index.end() ? i->second : invalid_participant_handle;
+}
+
+auto ParticipantRegistry::get(const ParticipantHandle handle) const -> Participant {
+    const auto& entry = entries[handle];
+    return Participant{
+        .handle         = handle,
+        .participant_id = entry.id,
+        .nick           = entry.nick,
+        .audio_muted    = is_muted(handle, true),
+        .video_muted    = is_muted(handle, false),
+    };
+}
+
+auto ParticipantRegistry::retain(const ParticipantHandle handle) -> void {
+    entries[handle].refs += 1;
+}
+
+auto ParticipantRegistry::release(const ParticipantHandle handle) -> void {
+    entries[handle].refs -= 1;
+    recycle_if_unused(handle);
+}
+
+auto ParticipantRegistry::set_joined(const ParticipantHandle handle) -> void {
+    if(!is_present(handle)) {
+        present_count += 1;
+    }
+    flags[handle] = Present | AudioMuted | VideoMuted;
+    entries[handle].nick.clear();
+    entries[handle].presence_digest = 0;
+}
+
+auto ParticipantRegistry::set_left(const ParticipantHandle handle) -> void {
+    if(!is_present(handle)) {
+        return;
+    }
+    present_count -= 1;
+    flags[handle] &= ~Present;
+    recycle_if_unused(handle);
+}
+
+auto ParticipantRegistry::set_muted(const ParticipantHandle handle, const bool is_audio, const bool muted) -> void {
+    const auto bit = is_audio ? AudioMuted : VideoMuted;
+    flags[handle]  = muted ? (flags[handle] | bit) : (flags[handle] & ~bit);
+}
+
+auto ParticipantRegistry::recycle_if_unused(const ParticipantHandle handle) -> void {
+    if(is_present(handle) || entries[handle].refs != 0) {
+        return;
+    }
+    // the key refers to the id, erase it first
+    index.erase(entries[handle].id);
+    entries[handle] = Entry();
+    flags[handle]   = 0;
+    free_handles.push_back(handle);
+}
+} // namespace conference
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace conference {
+using ParticipantHandle = uint32_t;
+
+constexpr auto invalid_participant_handle = ParticipantHandle(-1);
+
+// view of a registry entry
+// participant_id stays valid until the handle is recycled, nick until the participant sends a new nick
+struct Participant {
+    ParticipantHandle handle;
+    std::string_view  participant_id;
+    std::string_view  nick;
+    bool              audio_muted;
+    bool              video_muted;
+};
+
+// interns participant ids (muc resources) and hands out stable integer handles
+// ids can be interned before the participant joins, e.g. from ssrc owners
+// the handle of a participant which left is recycled once nothing retains it
+struct ParticipantRegistry {
+    enum Flags : uint8_t {
+        Present    = 1 << 0,
+        AudioMuted = 1 << 1,
+        VideoMuted = 1 << 2,
+    };
+
+    struct Entry {
+        std::string id;
+        std::string nick;
+        uint64_t    presence_digest = 0; // used to skip unchanged presences
+        uint32_t    refs            = 0; // e.g. ssrc table sources and pending events
+    };
+
+    std::deque<Entry>                                       entries; // indexed by handle, addresses are stable
+    std::vector<uint8_t>                                    flags;   // indexed by handle, hot data kept dense
+    std::unordered_map<std::string_view, ParticipantHandle> index;   // keys refer to entries[].id
+    std::vector<ParticipantHandle>                          free_handles;
+    size_t                                                  present_count = 0;
+
+    auto intern(std::string_view id) -> ParticipantHandle;
+    auto find(std::string_view id) const -> ParticipantHandle;
+    auto get(ParticipantHandle handle) const -> Participant;
+    // keeps the handle from being recycled after the participant left
+    auto retain(ParticipantHandle handle) -> void;
+    auto release(ParticipantHandle handle) -> void;
+
+    auto is_present(ParticipantHandle handle) const -> bool {
+        return flags[handle] & Present;
+    }
+
+    auto is_muted(ParticipantHandle handle, bool is_audio) const -> bool {
+        return flags[handle] & (is_audio ? AudioMuted : VideoMuted);
+    }
+
+    auto get_id(ParticipantHandle handle) const -> std::string_view {
+        return entries[handle].id;
+    }
+
+    // resets nick and mute state
+    auto set_joined(ParticipantHandle handle) -> void;
+    auto set_left(ParticipantHandle handle) -> void;
+    auto set_muted(ParticipantHandle handle, bool is_audio, bool muted) -> void;
+
+  private:
+    auto recycle_if_unused(ParticipantHandle handle) -> void;
+};
+} // namespace conference
@@ -2,7 +2,8 @@
 
 namespace rng {
 namespace {
-auto engine = std::mt19937((std::random_device())());
+// one engine per thread, so conferences on different threads do not race
+thread_local auto engine = std::mt19937((std::random_device())());
 } // namespace
 
 auto generate_random_uint32() -> uint32_t {
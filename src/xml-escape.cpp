@@ -0,0 +1,177 @@
+#include <charconv>
+#include <cstdint>
+#include <optional>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "xml-escape.hpp"
+
+namespace escape {
+namespace {
+auto is_special(const char c) -> bool {
+    return c == '&' || c == '<' || c == '>' || c == '"' || c == '\'';
+}
+
+// returns the first character which needs escaping, or end
+auto find_special(const char* ptr, const char* const end) -> const char* {
+#if defined(__SSE2__)
+    const auto amp  = _mm_set1_epi8('&');
+    const auto lt   = _mm_set1_epi8('<');
+    const auto gt   = _mm_set1_epi8('>');
+    const auto quot = _mm_set1_epi8('"');
+    const auto apos = _mm_set1_epi8('\'');
+    while(end - ptr >= 16) {
+        const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        auto       hit   = _mm_cmpeq_epi8(chunk, amp);
+        hit              = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, lt));
+        hit              = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, gt));
+        hit              = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, quot));
+        hit              = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, apos));
+        if(const auto mask = _mm_movemask_epi8(hit); mask != 0) {
+            return ptr + __builtin_ctz(mask);
+        }
+        ptr += 16;
+    }
+#endif
+    while(ptr < end && !is_special(*ptr)) {
+        ptr += 1;
+    }
+    return ptr;
+}
+
+auto entity_of(const char c) -> std::string_view {
+    switch(c) {
+    case '&':
+        return "&amp;";
+    case '<':
+        return "&lt;";
+    case '>':
+        return "&gt;";
+    case '"':
+        return "&quot;";
+    default:
+        return "&apos;";
+    }
+}
+
+auto append_utf8(std::string& str, const uint32_t code) -> void {
+    if(code < 0x80) {
+        str += char(code);
+    } else if(code < 0x800) {
+        str += char(0xC0 | (code >> 6));
+        str += char(0x80 | (code & 0x3F));
+    } else if(code < 0x10000) {
+        str += char(0xE0 | (code >> 12));
+        str += char(0x80 | ((code >> 6) & 0x3F));
+        str += char(0x80 | (code & 0x3F));
+    } else {
+        str += char(0xF0 | (code >> 18));
+        str += char(0x80 | ((code >> 12) & 0x3F));
+        str += char(0x80 | ((code >> 6) & 0x3F));
+        str += char(0x80 | (code & 0x3F));
+    }
+}
+
+auto parse_code_point(const std::string_view str, const int base) -> std::optional<uint32_t> {
+    auto       code      = uint32_t();
+    const auto end       = str.data() + str.size();
+    const auto [ptr, ec] = std::from_chars(str.data(), end, code, base);
+    if(str.empty() || ec != std::errc() || ptr != end || code > 0x10FFFF) {
+        return std::nullopt;
+    }
+    return code;
+}
+
+// entity is the text between '&' and ';'
+auto decode_entity(const std::string_view entity, std::string& out) -> bool {
+    if(entity == "amp") {
+        out += '&';
+    } else if(entity == "lt") {
+        out += '<';
+    } else if(entity == "gt") {
+        out += '>';
+    } else if(entity == "quot") {
+        out += '"';
+    } else if(entity == "apos") {
+        out += '\'';
+    } else if(entity.starts_with("#x") || entity.starts_with("#X")) {
+        const auto code = parse_code_point(entity.substr(2), 16);
+        if(!code) {
+            return false;
+        }
+        append_utf8(out, *code);
+    } else if(entity.starts_with("#")) {
+        const auto code = parse_code_point(entity.substr(1), 10);
+        if(!code) {
+            return false;
+        }
+        append_utf8(out, *code);
+    } else {
+        return false;
+    }
+    return true;
+}
+} // namespace
+
+auto xml_escape(const std::string_view str, std::string& buf) -> std::string_view {
+    const auto end = str.data() + str.size();
+    auto       ptr = find_special(str.data(), end);
+    if(ptr == end) {
+        return str;
+    }
+    buf.clear();
+    buf.reserve(str.size() + str.size() / 8 + 8);
+    auto done = str.data();
+    while(ptr != end) {
+        buf.append(done, ptr);
+        buf += entity_of(*ptr);
+        done = ptr + 1;
+        ptr  = find_special(done, end);
+    }
+    buf.append(done, end);
+    return buf;
+}
+
+auto xml_unescape(const std::string_view str, std::string& buf) -> std::string_view {
+    // memchr is vectorized by libc
+    auto amp = str.find('&');
+    if(amp == str.npos) {
+        return str;
+    }
+    buf.clear();
+    buf.reserve(str.size());
+    auto done = 0uz;
+    while(amp != str.npos) {
+        buf.append(str.substr(done, amp - done));
+        const auto semi = str.find(';', amp);
+        if(semi == str.npos || !decode_entity(str.substr(amp + 1, semi - amp - 1), buf)) {
+            // not an entity, keep as is
+            buf += '&';
+            done = amp + 1;
+        } else {
+            done = semi + 1;
+        }
+        amp = str.find('&', done);
+    }
+    buf.append(str.substr(done));
+    return buf;
+}
+
+auto xml_escape(const std::string_view str) -> std::string {
+    auto buf = std::string();
+    if(xml_escape(str, buf).data() == str.data()) {
+        return std::string(str);
+    }
+    return buf;
+}
+
+auto xml_unescape(const std::string_view str) -> std::string {
+    auto buf = std::string();
+    if(xml_unescape(str, buf).data() == str.data()) {
+        return std::string(str);
+    }
+    return buf;
+}
+} // namespace escape
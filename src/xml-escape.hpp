@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+namespace escape {
+// single pass xml entity conversion
+// when the input needs no conversion, the input itself is returned and buf is untouched
+// otherwise the result is written to buf and a view of it is returned
+auto xml_escape(std::string_view str, std::string& buf) -> std::string_view;
+auto xml_unescape(std::string_view str, std::string& buf) -> std::string_view;
+
+auto xml_escape(std::string_view str) -> std::string;
+auto xml_unescape(std::string_view str) -> std::string;
+} // namespace escape
@@ -0,0 +1,218 @@
+#include <algorithm>
+
+#include "macros/logger.hpp"
+#include "xml-escape.hpp"
+#include "xml-view.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "macros/unwrap.hpp"
+
+namespace xmlview {
+namespace {
+auto logger = Logger("xmlview");
+
+auto is_space(const char c) -> bool {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+auto is_blank(const std::string_view str) -> bool {
+    return std::ranges::all_of(str, is_space);
+}
+
+struct Parser {
+    std::string_view str;
+    size_t           pos = 0;
+
+    auto peek(const std::string_view prefix) const -> bool {
+        return str.substr(pos).starts_with(prefix);
+    }
+
+    auto skip_space() -> void {
+        while(pos < str.size() && is_space(str[pos])) {
+            pos += 1;
+        }
+    }
+
+    auto skip_past(const std::string_view terminator) -> bool {
+        const auto i = str.find(terminator, pos);
+        ensure(i != str.npos, "unterminated {}", terminator);
+        pos = i + terminator.size();
+        return true;
+    }
+
+    auto read_name() -> std::string_view {
+        const auto begin = pos;
+        while(pos < str.size() && !is_space(str[pos]) && str[pos] != '/' && str[pos] != '>' && str[pos] != '=') {
+            pos += 1;
+        }
+        return str.substr(begin, pos - begin);
+    }
+};
+} // namespace
+
+auto Node::find_attr(const std::string_view key) const -> std::optional<std::string_view> {
+    for(const auto& attr : attrs) {
+        if(attr.key == key) {
+            return attr.value;
+        }
+    }
+    return std::nullopt;
+}
+
+auto Node::is_attr_equal(const std::string_view key, const std::string_view value) const -> bool {
+    const auto attr = find_attr(key);
+    if(!attr) {
+        return false;
+    }
+    auto buf = std::string();
+    return escape::xml_unescape(*attr, buf) == value;
+}
+
+auto Node::find_first_child(const std::string_view child_name) const -> const Node* {
+    for(auto child = first_child; child != nullptr; child = child->next_sibling) {
+        if(child->name == child_name) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+auto Node::get_data() const -> std::string {
+    return escape::xml_unescape(data);
+}
+
+auto Node::get_attr(const std::string_view key) const -> std::optional<std::string> {
+    unwrap(attr, find_attr(key));
+    return escape::xml_unescape(attr);
+}
+
+auto Node::to_node() const -> xml::Node {
+    auto node = xml::Node{
+        .name = std::string(name),
+        .data = get_data(),
+    };
+    for(const auto& attr : attrs) {
+        node.attrs.push_back(xml::Attribute{std::string(attr.key), escape::xml_unescape(attr.value)});
+    }
+    for(const auto& child : children()) {
+        node.children.push_back(child.to_node());
+    }
+    return node;
+}
+
+auto Document::parse(const std::string_view str) -> const Node* {
+    // reserve upper bounds so that node pointers stay valid while parsing
+    nodes.clear();
+    attrs.clear();
+    nodes.reserve(std::ranges::count(str, '<'));
+    attrs.reserve(std::ranges::count(str, '='));
+
+    auto parser = Parser{.str = str};
+    auto stack  = std::vector<Node*>();
+    auto root   = (Node*)(nullptr);
+    while(parser.pos < str.size()) {
+        if(str[parser.pos] != '<') {
+            // text
+            const auto begin = parser.pos;
+            const auto end   = std::min(str.find('<', begin), str.size());
+            const auto text  = str.substr(begin, end - begin);
+            parser.pos       = end;
+            if(!stack.empty() && stack.back()->data.empty() && !is_blank(text)) {
+                stack.back()->data = text;
+            }
+            continue;
+        }
+        if(parser.peek("<?")) {
+            ensure(parser.skip_past("?>"));
+            continue;
+        }
+        if(parser.peek("<!--")) {
+            ensure(parser.skip_past("-->"));
+            continue;
+        }
+        if(parser.peek("<![CDATA[")) {
+            const auto begin = parser.pos + 9;
+            ensure(parser.skip_past("]]>"));
+            if(!stack.empty() && stack.back()->data.empty()) {
+                stack.back()->data = str.substr(begin, parser.pos - 3 - begin);
+            }
+            continue;
+        }
+        if(parser.peek("</")) {
+            // end tag
+            parser.pos += 2;
+            const auto name = parser.read_name();
+            parser.skip_space();
+            ensure(parser.peek(">"), "malformed end tag");
+            parser.pos += 1;
+            ensure(!stack.empty() && stack.back()->name == name, "mismatched end tag {}", name);
+            stack.pop_back();
+            if(stack.empty()) {
+                break;
+            }
+            continue;
+        }
+
+        // start tag
+        parser.pos += 1;
+        auto& node = nodes.emplace_back();
+        node.name  = parser.read_name();
+        ensure(!node.name.empty(), "empty tag name");
+
+        const auto attrs_begin = attrs.size();
+        auto       self_close  = false;
+        while(true) {
+            parser.skip_space();
+            ensure(parser.pos < str.size(), "unterminated tag {}", node.name);
+            if(parser.peek("/>")) {
+                parser.pos += 2;
+                self_close = true;
+                break;
+            }
+            if(parser.peek(">")) {
+                parser.pos += 1;
+                break;
+            }
+            const auto key = parser.read_name();
+            ensure(!key.empty(), "malformed attribute in {}", node.name);
+            parser.skip_space();
+            ensure(parser.peek("="), "attribute without value");
+            parser.pos += 1;
+            parser.skip_space();
+            ensure(parser.pos < str.size());
+            const auto quote = str[parser.pos];
+            ensure(quote == '"' || quote == '\'', "unquoted attribute value");
+            const auto value_begin = parser.pos + 1;
+            const auto value_end   = str.find(quote, value_begin);
+            ensure(value_end != str.npos, "unterminated attribute value");
+            parser.pos = value_end + 1;
+            attrs.push_back(Attribute{key, str.substr(value_begin, value_end - value_begin)});
+        }
+        node.attrs = std::span(attrs.data() + attrs_begin, attrs.size() - attrs_begin);
+
+        if(stack.empty()) {
+            ensure(root == nullptr, "multiple root elements");
+            root = &node;
+        } else {
+            auto& parent = *stack.back();
+            if(parent.last_child == nullptr) {
+                parent.first_child = &node;
+            } else {
+                parent.last_child->next_sibling = &node;
+            }
+            parent.last_child = &node;
+        }
+        if(self_close) {
+            if(stack.empty()) {
+                break;
+            }
+        } else {
+            stack.push_back(&node);
+        }
+    }
+    ensure(root != nullptr, "no element found");
+    ensure(stack.empty(), "unclosed element {}", stack.back()->name);
+    return root;
+}
+
+} // namespace xmlview
@@ -0,0 +1,79 @@
+#pragma once
+#include <concepts>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "xml/xml.hpp"
+
+// read-only xml dom which references the parsed buffer instead of owning strings
+// entities in names, attributes and data are kept as is, use escape::xml_unescape() or get_*() to decode them
+namespace xmlview {
+struct Attribute {
+    std::string_view key;
+    std::string_view value; // raw
+};
+
+struct Node {
+    std::string_view           name;
+    std::string_view           data; // raw, first non-blank text run
+    std::span<const Attribute> attrs;
+    Node*                      first_child  = nullptr;
+    Node*                      last_child   = nullptr;
+    Node*                      next_sibling = nullptr;
+
+    struct ChildIterator {
+        const Node* node;
+
+        auto operator*() const -> const Node& {
+            return *node;
+        }
+
+        auto operator++() -> ChildIterator& {
+            node = node->next_sibling;
+            return *this;
+        }
+
+        auto operator==(const ChildIterator&) const -> bool = default;
+    };
+
+    struct ChildRange {
+        const Node* first;
+
+        auto begin() const -> ChildIterator {
+            return {first};
+        }
+
+        auto end() const -> ChildIterator {
+            return {nullptr};
+        }
+    };
+
+    auto children() const -> ChildRange {
+        return {first_child};
+    }
+
+    auto find_attr(std::string_view key) const -> std::optional<std::string_view>;
+    auto is_attr_equal(std::string_view key, std::string_view value) const -> bool;
+    auto find_first_child(std::string_view child_name) const -> const Node*;
+    auto find_first_child(std::string_view child_name, std::convertible_to<std::string_view> auto... rest) const -> const Node* {
+        const auto child = find_first_child(child_name);
+        return child != nullptr ? child->find_first_child(rest...) : nullptr;
+    }
+    auto get_data() const -> std::string;
+    auto get_attr(std::string_view key) const -> std::optional<std::string>;
+    // materialize an owning copy, for apis which only accept xml::Node
+    auto to_node() const -> xml::Node;
+};
+
+// owns node storage, can be reused to avoid reallocation
+// nodes are valid until the next parse() and refer to the parsed buffer
+struct Document {
+    std::vector<Node>      nodes;
+    std::vector<Attribute> attrs;
+
+    auto parse(std::string_view str) -> const Node*;
+};
+} // namespace xmlview
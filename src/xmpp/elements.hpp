@@ -9,6 +9,7 @@ constexpr auto nick          = "http://jabber.org/protocol/nick";
 constexpr auto muc           = "http://jabber.org/protocol/muc";
 constexpr auto muc_user      = "http://jabber.org/protocol/muc#user";
 constexpr auto jitsi_focus   = "http://jitsi.org/protocol/focus";
+constexpr auto sm            = "urn:xmpp:sm:3";
 } // namespace xmpp::ns
 
 namespace xmpp::elm {
@@ -133,4 +134,32 @@ inline const auto ping = xml::Node{
         {"xmlns", "urn:xmpp:ping"},
     },
 };
+inline const auto sm_enable = xml::Node{
+    .name  = "enable",
+    .attrs = {
+        {"xmlns", ns::sm},
+        {"resume", "true"},
+    },
+};
+inline const auto sm_resume = xml::Node{
+    .name  = "resume",
+    .attrs = {
+        {"xmlns", ns::sm},
+        // h
+        // previd
+    },
+};
+inline const auto sm_request = xml::Node{
+    .name  = "r",
+    .attrs = {
+        {"xmlns", ns::sm},
+    },
+};
+inline const auto sm_answer = xml::Node{
+    .name  = "a",
+    .attrs = {
+        {"xmlns", ns::sm},
+        // h
+    },
+};
 } // namespace xmpp::elm
@@ -1,7 +1,8 @@
 #include "extdisco.hpp"
 #include "../macros/logger.hpp"
 #include "../util/charconv.hpp"
-#include "../xml/xml.hpp"
+#include "../xml-escape.hpp"
+#include "../xml-view.hpp"
 
 #define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
 #include "../macros/unwrap.hpp"
@@ -10,26 +11,28 @@ namespace xmpp {
 namespace {
 auto logger = Logger("xmpp");
 
-auto parse_service(const xml::Node& node) -> std::optional<Service> {
+auto parse_service(const xmlview::Node& node) -> std::optional<Service> {
     auto r          = Service{};
     auto found_type = false;
     auto found_host = false;
 
     for(const auto& a : node.attrs) {
         if(a.key == "type") {
-            r.type     = a.value;
+            r.type     = escape::xml_unescape(a.value);
             found_type = true;
         } else if(a.key == "host") {
-            r.host     = a.value;
+            r.host     = escape::xml_unescape(a.value);
             found_host = true;
         } else if(a.key == "name") {
-            r.name = a.value;
+            r.name = escape::xml_unescape(a.value);
         } else if(a.key == "transport") {
-            r.transport = a.value;
+            r.transport = escape::xml_unescape(a.value);
         } else if(a.key == "username") {
-            r.username = a.value;
+            r.username = escape::xml_unescape(a.value);
         } else if(a.key == "password") {
-            r.password = a.value;
+            r.password = escape::xml_unescape(a.value);
+        } else if(a.key == "expires") {
+            r.expires = escape::xml_unescape(a.value);
         } else if(a.key == "port") {
             unwrap(num, from_chars<uint16_t>(a.value));
             r.port = num;
@@ -49,7 +52,7 @@ auto parse_service(const xml::Node& node) -> std::optional<Service> {
     if(!found_type || !found_host) {
         bail("required attributes not found");
     }
-    for(const auto& c : node.children) {
+    for(const auto& c : node.children()) {
         if(0) {
         } else {
             LOG_WARN(logger, "unhandled child {}", c.name);
@@ -58,9 +61,9 @@ auto parse_service(const xml::Node& node) -> std::optional<Service> {
     return r;
 }
 } // namespace
-auto parse_services(const xml::Node& services) -> std::optional<std::vector<Service>> {
+auto parse_services(const xmlview::Node& services) -> std::optional<std::vector<Service>> {
     auto r = std::vector<Service>();
-    for(const auto& service : services.children) {
+    for(const auto& service : services.children()) {
         if(service.name != "service") {
             continue;
         }
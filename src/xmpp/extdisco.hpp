@@ -4,7 +4,7 @@
 #include <string>
 #include <vector>
 
-namespace xml {
+namespace xmlview {
 struct Node;
 }
 
@@ -21,5 +21,5 @@ struct Service {
     bool        restricted = false;
 };
 
-auto parse_services(const xml::Node& services) -> std::optional<std::vector<Service>>;
+auto parse_services(const xmlview::Node& services) -> std::optional<std::vector<Service>>;
 } // namespace xmpp
@@ -15,17 +15,19 @@ auto negotiate(Negotiator* const negotiator) -> Negotiator::Worker::Generator {
     constexpr auto error_value = FeedResult::Error;
 
     LOG_DEBUG(logger, "negotiation started");
-    auto& self = *negotiator;
+    auto& self         = *negotiator;
+    auto  sm_supported = false;
     // open
     {
+        trace::begin(self.join_trace, trace::Phase::StreamOpen);
         const auto open = xmpp::elm::open.clone().append_attrs({
             {"to", self.host},
         });
-        self.callbacks->send_payload(xml::deparse(open));
+        self.send(xml::deparse(open));
         co_yield FeedResult::Continue;
 
         while(true) {
-            const auto response = xml::parse(self.worker_arg).value();
+            const auto& response = *self.worker_arg;
             if(response.name == "open" && response.is_attr_equal("from", self.host)) {
                 break;
             }
@@ -37,20 +39,22 @@ auto negotiate(Negotiator* const negotiator) -> Negotiator::Worker::Generator {
         co_yield FeedResult::Continue;
 
         while(true) {
-            const auto response = xml::parse(self.worker_arg).value();
+            const auto& response = *self.worker_arg;
             if(response.name == "stream:features") {
                 break;
             }
             co_yield FeedResult::Continue;
         }
+        trace::end(self.join_trace, trace::Phase::StreamOpen);
     }
-    // auth
+    // auth, including the stream restart
     {
+        trace::begin(self.join_trace, trace::Phase::Auth);
         const auto auth = xmpp::elm::auth;
-        self.callbacks->send_payload(xml::deparse(auth));
+        self.send(xml::deparse(auth));
         co_yield FeedResult::Continue;
 
-        const auto response = xml::parse(self.worker_arg).value();
+        const auto& response = *self.worker_arg;
         co_ensure_v(response.name == "success");
     }
     // open
@@ -58,14 +62,16 @@ auto negotiate(Negotiator* const negotiator) -> Negotiator::Worker::Generator {
         const auto open = xmpp::elm::open.clone().append_attrs({
             {"to", self.host},
         });
-        self.callbacks->send_payload(xml::deparse(open));
+        self.send(xml::deparse(open));
         co_yield FeedResult::Continue;
 
-        const auto response = xml::parse(self.worker_arg).value();
+        const auto& response = *self.worker_arg;
         co_ensure_v(response.name == "open");
+        trace::end(self.join_trace, trace::Phase::Auth);
     }
     // bind
     {
+        trace::begin(self.join_trace, trace::Phase::Bind);
         const auto id = self.generate_iq_id();
         const auto iq = xmpp::elm::iq.clone()
                             .append_attrs({
@@ -75,12 +81,15 @@ auto negotiate(Negotiator* const negotiator) -> Negotiator::Worker::Generator {
                             .append_children({
                                 xmpp::elm::bind,
                             });
-        self.callbacks->send_payload(xml::deparse(iq));
+        self.send(xml::deparse(iq));
         co_yield FeedResult::Continue;
 
         while(true) {
-            const auto response = xml::parse(self.worker_arg).value();
+            const auto& response = *self.worker_arg;
             if(response.name != "iq") {
+                if(response.name == "stream:features" && response.find_first_child("sm") != nullptr) {
+                    sm_supported = true;
+                }
                 co_yield FeedResult::Continue;
                 continue;
             }
@@ -91,86 +100,231 @@ auto negotiate(Negotiator* const negotiator) -> Negotiator::Worker::Generator {
             break;
         }
         LOG_DEBUG(logger, "jid: {}", self.jid.as_full());
+        trace::end(self.join_trace, trace::Phase::Bind);
     }
-    // disco
+    // stream management
+    if(self.stream_manager != nullptr) {
+        if(!sm_supported) {
+            LOG_WARN(logger, "stream management not supported");
+        } else {
+            trace::begin(self.join_trace, trace::Phase::StreamManagement);
+            self.send(self.stream_manager->build_enable());
+            co_yield FeedResult::Continue;
+
+            while(true) {
+                const auto& response = *self.worker_arg;
+                if(response.name == "enabled" || response.name == "failed") {
+                    if(!self.stream_manager->handle_enabled(response)) {
+                        LOG_WARN(logger, "continuing without stream management");
+                    }
+                    trace::end(self.join_trace, trace::Phase::StreamManagement);
+                    break;
+                }
+                co_yield FeedResult::Continue;
+            }
+        }
+    }
+    // disco and extdisco, in flight at the same time and answered in any order
     {
-        const auto id = self.generate_iq_id();
-        const auto iq = xmpp::elm::iq.clone()
-                            .append_attrs({
-                                {"id", id},
-                                {"type", "get"},
-                                {"from", self.jid.as_full()},
-                                {"to", self.host},
-                            })
-                            .append_children({
-                                xmpp::elm::query,
-                            });
-        self.callbacks->send_payload(xml::deparse(iq));
+        trace::begin(self.join_trace, trace::Phase::Disco);
+        const auto disco_id    = self.generate_iq_id();
+        const auto extdisco_id = self.generate_iq_id();
+        const auto disco_iq    = xmpp::elm::iq.clone()
+                                     .append_attrs({
+                                         {"id", disco_id},
+                                         {"type", "get"},
+                                         {"from", self.jid.as_full()},
+                                         {"to", self.host},
+                                     })
+                                     .append_children({
+                                         xmpp::elm::query,
+                                     });
+        const auto extdisco_iq = xmpp::elm::iq.clone()
+                                     .append_attrs({
+                                         {"id", extdisco_id},
+                                         {"type", "get"},
+                                         {"from", self.jid.as_full()},
+                                         {"to", self.host},
+                                     })
+                                     .append_children({
+                                         xmpp::elm::services,
+                                     });
+        // skip extdisco while the cached services are valid, or while another connection is refreshing them
+        auto extdisco_done = false;
+        auto extdisco_wait = false;
+        if(self.service_cache != nullptr) {
+            auto cached = self.service_cache->find(self.host);
+            if(!cached.services.empty()) {
+                self.external_services = std::move(cached.services);
+            }
+            extdisco_done = !cached.refresh && !cached.wait;
+            extdisco_wait = cached.wait;
+        }
+        self.send(xml::deparse(disco_iq));
+        if(!extdisco_done && !extdisco_wait) {
+            self.send(xml::deparse(extdisco_iq));
+        }
+        // requests sent from here are pipelined with ours, their responses are returned as Forward
+        self.callbacks->on_bound(self.jid);
+
+        auto disco_done = false;
+        auto result     = FeedResult::Continue;
+        while(!disco_done || !extdisco_done) {
+            co_yield result;
+            result = FeedResult::Continue;
+
+            const auto& response = *self.worker_arg;
+            if(response.name == "iq" && response.is_attr_equal("id", disco_id)) {
+                co_ensure_v(response.is_attr_equal("type", "result"), "unexpected iq");
+                // TODO: parse disco
+                disco_done = true;
+            } else if(response.name == "iq" && response.is_attr_equal("id", extdisco_id)) {
+                extdisco_done = true;
+                if(!response.is_attr_equal("type", "result")) {
+                    LOG_WARN(logger, "extdisco not supported");
+                    // not cached, the next connection asks again
+                    if(self.service_cache != nullptr) {
+                        self.service_cache->abandon_refresh(self.host);
+                    }
+                    continue;
+                }
+                co_unwrap_v(services, response.find_first_child("services"));
+                co_ensure_v(services.is_attr_equal("xmlns", xmpp::ns::xmpp_extdisco));
+                if(auto sv_o = parse_services(services); sv_o) {
+                    self.external_services = std::move(*sv_o);
+                    if(self.service_cache != nullptr) {
+                        self.service_cache->store(self.host, self.external_services);
+                    }
+                } else if(self.service_cache != nullptr) {
+                    self.service_cache->abandon_refresh(self.host);
+                }
+            } else {
+                result = FeedResult::Forward;
+            }
+
+            // take the services once the refreshing connection stored them
+            // nothing resumes this worker after disco is answered, so it stops waiting and asks by itself then
+            if(extdisco_wait) {
+                auto cached = self.service_cache->find(self.host);
+                if(!cached.wait || disco_done) {
+                    extdisco_wait = false;
+                    if(!cached.services.empty()) {
+                        self.external_services = std::move(cached.services);
+                    }
+                    extdisco_done = !cached.refresh && !cached.wait;
+                    if(!extdisco_done) {
+                        self.send(xml::deparse(extdisco_iq));
+                    }
+                }
+            }
+        }
+        trace::end(self.join_trace, trace::Phase::Disco);
+    }
+    co_return FeedResult::Done;
+}
+
+// requests are pipelined, so that resumption takes two round trips after connecting
+auto resume(Negotiator* const negotiator) -> Negotiator::Worker::Generator {
+    constexpr auto error_value = FeedResult::Error;
+
+    LOG_DEBUG(logger, "resumption started");
+    auto&      self = *negotiator;
+    const auto open = xmpp::elm::open.clone().append_attrs({
+        {"to", self.host},
+    });
+    // open and auth
+    {
+        self.send(xml::deparse(open));
+        self.send(xml::deparse(xmpp::elm::auth));
         co_yield FeedResult::Continue;
 
         while(true) {
-            const auto response = xml::parse(self.worker_arg).value();
-            if(response.name != "iq") {
-                co_yield FeedResult::Continue;
-                continue;
+            const auto& response = *self.worker_arg;
+            if(response.name == "success") {
+                break;
             }
-            co_ensure_v(response.is_attr_equal("id", id), "unexpected iq");
-            co_ensure_v(response.is_attr_equal("type", "result"), "unexpected iq");
-            // TODO: parse disco
-            break;
+            co_ensure_v(response.name == "open" || response.name == "stream:features", "unexpected response {}", response.name);
+            co_yield FeedResult::Continue;
         }
     }
-    // disco ext
+    // open and resume
     {
-        const auto id = self.generate_iq_id();
-        const auto iq = xmpp::elm::iq.clone()
-                            .append_attrs({
-                                {"id", id},
-                                {"type", "get"},
-                                {"from", self.jid.as_full()},
-                                {"to", self.host},
-                            })
-                            .append_children({
-                                xmpp::elm::services,
-                            });
-        self.callbacks->send_payload(xml::deparse(iq));
+        self.send(xml::deparse(open));
+        self.send(self.stream_manager->build_resume());
         co_yield FeedResult::Continue;
 
         while(true) {
-            const auto response = xml::parse(self.worker_arg).value();
-            if(response.name != "iq") {
-                co_yield FeedResult::Continue;
-                continue;
-            }
-            co_ensure_v(response.is_attr_equal("id", id), "unexpected iq");
-            if(!response.is_attr_equal("type", "result")) {
-                LOG_WARN(logger, "extdisco not supported");
+            const auto& response = *self.worker_arg;
+            if(response.name == "resumed" || response.name == "failed") {
+                co_unwrap_v(resend, self.stream_manager->handle_resumed(response));
+                LOG_DEBUG(logger, "resumed, sending {} unacked stanzas again", resend.size());
+                for(const auto& payload : resend) {
+                    self.send(payload);
+                }
                 break;
             }
-            co_unwrap_v(services, response.find_first_child("services"));
-            co_ensure_v(services.is_attr_equal("xmlns", xmpp::ns::xmpp_extdisco));
-            if(auto sv_o = parse_services(services); sv_o) {
-                self.external_services = std::move(*sv_o);
-            }
-            break;
+            co_ensure_v(response.name == "open" || response.name == "stream:features", "unexpected response {}", response.name);
+            co_yield FeedResult::Continue;
         }
     }
     co_return FeedResult::Done;
 }
 } // namespace
 
+auto Negotiator::send(const std::string_view payload) -> void {
+    callbacks->send_payload(payload);
+    if(stream_manager != nullptr) {
+        stream_manager->on_sent(payload);
+    }
+}
+
 auto Negotiator::generate_iq_id() -> std::string {
-    return std::format("iq_{}", (iq_serial += 1));
+    return std::format("neg_{}", iq_serial.fetch_add(1, std::memory_order_relaxed) + 1);
 }
 
 auto Negotiator::start_negotiation() -> void {
+    if(stream_manager != nullptr) {
+        // a new session, nothing is counted until enabled again
+        stream_manager->enabled = false;
+    }
     worker.start(negotiate, this);
     worker.resume();
 }
 
+auto Negotiator::start_resumption() -> bool {
+    ensure(stream_manager != nullptr && stream_manager->resumable, "session is not resumable");
+    worker.start(resume, this);
+    worker.resume();
+    return true;
+}
+
 auto Negotiator::feed_payload(std::string_view payload) -> FeedResult {
-    worker_arg = payload;
-    return worker.resume();
+    const auto stanza = worker_doc.parse(payload);
+    if(stanza == nullptr) {
+        LOG_ERROR(logger, "xml parse error");
+        return FeedResult::Error;
+    }
+    if(stream_manager != nullptr) {
+        auto reply = std::string();
+        if(stream_manager->handle_nonza(*stanza, reply)) {
+            if(!reply.empty()) {
+                send(reply);
+            }
+            return FeedResult::Continue;
+        }
+    }
+    if(worker.done()) {
+        // frames which arrive before the caller switches to the conference
+        return FeedResult::Forward;
+    }
+    worker_arg = stanza;
+    const auto result = worker.resume();
+    worker_arg = nullptr;
+    // forwarded stanzas are counted by their receiver
+    if(stream_manager != nullptr && result != FeedResult::Forward) {
+        stream_manager->count_received(*stanza);
+    }
+    return result;
 }
 
 auto Negotiator::create(std::string host, NegotiatorCallbacks* const callbacks) -> std::unique_ptr<Negotiator> {
@@ -1,16 +1,26 @@
 #pragma once
+#include <atomic>
 #include <memory>
 #include <string_view>
 #include <vector>
 
+#include "../join-trace.hpp"
 #include "../util/coroutine.hpp"
+#include "../xml-view.hpp"
 #include "extdisco.hpp"
 #include "jid.hpp"
+#include "service-cache.hpp"
+#include "stream-manager.hpp"
 
 namespace xmpp {
 struct NegotiatorCallbacks {
     virtual auto send_payload(std::string_view /*payload*/) -> void = 0;
 
+    // called once the jid is bound, while disco queries are in flight
+    // e.g. a conference can be started here to pipeline its first request with them
+    virtual auto on_bound(const Jid& /*jid*/) -> void {
+    }
+
     virtual ~NegotiatorCallbacks(){};
 };
 
@@ -18,6 +28,7 @@ enum class FeedResult {
     Continue,
     Error,
     Done,
+    Forward, // not for the negotiator, pass it to whoever sent requests from on_bound, also returned after Done
 };
 
 struct Negotiator {
@@ -26,18 +37,27 @@ struct Negotiator {
     // constant
     std::string          host;
     NegotiatorCallbacks* callbacks;
+    StreamManager*       stream_manager = nullptr;               // optional, enables xep-0198 if the server supports it
+    trace::JoinTrace*    join_trace     = nullptr;               // optional
+    ServiceCache*        service_cache  = &ServiceCache::get(); // set nullptr to always request extdisco
 
     // worker
-    std::string_view worker_arg;
-    Worker           worker;
+    xmlview::Document    worker_doc;
+    const xmlview::Node* worker_arg;
+    Worker               worker;
 
     // state
-    Jid                  jid;
-    std::vector<Service> external_services;
-    static inline int    iq_serial;
+    Jid                           jid;
+    std::vector<Service>          external_services;
+    static inline std::atomic_int iq_serial; // shared by every negotiator in the process, ids are prefixed apart from the conference ones
 
     auto generate_iq_id() -> std::string;
+    auto send(std::string_view payload) -> void;
     auto start_negotiation() -> void;
+    // resumes the session of stream_manager on a new connection instead of negotiating a new one
+    // jid and external_services are kept from the previous negotiation
+    // Error means the server refused to resume, the session is lost and start_negotiation is needed on a new connection
+    auto start_resumption() -> bool;
     auto feed_payload(std::string_view payload) -> FeedResult;
 
     static auto create(std::string host, NegotiatorCallbacks* callbacks) -> std::unique_ptr<Negotiator>;
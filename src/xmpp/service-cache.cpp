@@ -0,0 +1,120 @@
+#include <algorithm>
+
+#include "../macros/logger.hpp"
+#include "../util/charconv.hpp"
+#include "service-cache.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "../macros/unwrap.hpp"
+
+namespace xmpp {
+namespace {
+auto logger = Logger("xmpp-cache");
+
+template <class T>
+auto take_number(std::string_view& str, const size_t digits) -> std::optional<T> {
+    ensure(str.size() >= digits);
+    unwrap(num, from_chars<T>(str.substr(0, digits)));
+    str.remove_prefix(digits);
+    return num;
+}
+
+auto take_char(std::string_view& str, const char c) -> bool {
+    ensure(!str.empty() && str[0] == c);
+    str.remove_prefix(1);
+    return true;
+}
+} // namespace
+
+auto parse_expires(std::string_view str) -> std::optional<std::chrono::system_clock::time_point> {
+    unwrap(year, take_number<int>(str, 4));
+    ensure(take_char(str, '-'));
+    unwrap(month, take_number<unsigned>(str, 2));
+    ensure(take_char(str, '-'));
+    unwrap(day, take_number<unsigned>(str, 2));
+    ensure(take_char(str, 'T'));
+    unwrap(hour, take_number<int>(str, 2));
+    ensure(take_char(str, ':'));
+    unwrap(minute, take_number<int>(str, 2));
+    ensure(take_char(str, ':'));
+    unwrap(second, take_number<int>(str, 2));
+    // fraction, ignored
+    if(!str.empty() && str[0] == '.') {
+        str.remove_prefix(1);
+        while(!str.empty() && str[0] >= '0' && str[0] <= '9') {
+            str.remove_prefix(1);
+        }
+    }
+    auto offset = std::chrono::minutes(0);
+    if(!str.empty() && (str[0] == '+' || str[0] == '-')) {
+        const auto sign = str[0] == '+' ? 1 : -1;
+        str.remove_prefix(1);
+        unwrap(offset_hour, take_number<int>(str, 2));
+        ensure(take_char(str, ':'));
+        unwrap(offset_minute, take_number<int>(str, 2));
+        offset = std::chrono::minutes(sign * (offset_hour * 60 + offset_minute));
+    } else {
+        ensure(take_char(str, 'Z'), "unknown timezone in {}", str);
+    }
+    ensure(str.empty());
+
+    const auto date = std::chrono::year_month_day(std::chrono::year(year), std::chrono::month(month), std::chrono::day(day));
+    ensure(date.ok());
+    return std::chrono::sys_days(date) + std::chrono::hours(hour) + std::chrono::minutes(minute) + std::chrono::seconds(second) - offset;
+}
+
+auto ServiceCache::find(const std::string_view host) -> Lookup {
+    const auto now     = Clock::now();
+    const auto lock    = std::lock_guard(mutex);
+    auto&      entry   = entries[std::string(host)]; // a new entry is expired
+    const auto stalled = entry.refreshing && now - entry.refresh_started >= refresh_timeout;
+    const auto claim   = !entry.refreshing || stalled;
+    if(entry.expires <= now) {
+        if(!claim) {
+            return Lookup{.services = {}, .refresh = false, .wait = true};
+        }
+        entry.refreshing      = true;
+        entry.refresh_started = now;
+        return Lookup{.services = {}, .refresh = true, .wait = false};
+    }
+    const auto refresh = claim && entry.expires - now < refresh_window;
+    if(refresh) {
+        entry.refreshing      = true;
+        entry.refresh_started = now;
+    }
+    return Lookup{.services = entry.services, .refresh = refresh, .wait = false};
+}
+
+auto ServiceCache::store(const std::string_view host, std::vector<Service> services) -> void {
+    if(services.empty()) {
+        abandon_refresh(host);
+        return;
+    }
+    auto expires = std::optional<Clock::time_point>();
+    for(const auto& service : services) {
+        if(service.expires.empty()) {
+            continue;
+        }
+        if(const auto time = parse_expires(service.expires); time) {
+            expires = expires ? std::min(*expires, *time) : *time;
+        }
+    }
+    const auto lock  = std::lock_guard(mutex);
+    auto&      entry = entries[std::string(host)];
+    entry.services   = std::move(services);
+    entry.expires    = expires ? *expires : Clock::now() + default_ttl;
+    entry.refreshing = false;
+}
+
+auto ServiceCache::abandon_refresh(const std::string_view host) -> void {
+    const auto lock = std::lock_guard(mutex);
+    if(const auto i = entries.find(host); i != entries.end()) {
+        i->second.refreshing = false;
+    }
+}
+
+auto ServiceCache::get() -> ServiceCache& {
+    static auto cache = ServiceCache();
+    return cache;
+}
+} // namespace xmpp
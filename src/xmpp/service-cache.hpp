@@ -0,0 +1,51 @@
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "../util/string-map.hpp"
+#include "extdisco.hpp"
+
+namespace xmpp {
+// parses the xsd:dateTime used in Service::expires, e.g. "2024-01-02T03:04:05Z" or "2024-01-02T03:04:05.678+09:00"
+auto parse_expires(std::string_view str) -> std::optional<std::chrono::system_clock::time_point>;
+
+// process-wide cache of extdisco results keyed by host, thread safe
+// an entry expires with the earliest expires of its services, or after default_ttl if none has one
+// within refresh_window before that, one lookup is told to refresh it while the others keep using the cached services
+// a missing or expired entry is claimed by one lookup, the others are told to wait until it is stored
+// a refresh which was not stored after refresh_timeout is taken over by the next lookup
+// empty or failed results are not cached
+struct ServiceCache {
+    using Clock = std::chrono::system_clock;
+
+    struct Entry {
+        std::vector<Service> services;
+        Clock::time_point    expires;
+        Clock::time_point    refresh_started; // valid while refreshing
+        bool                 refreshing = false;
+    };
+
+    struct Lookup {
+        std::vector<Service> services; // empty unless the entry is valid
+        bool                 refresh;  // the caller should request extdisco and store the result
+        bool                 wait;     // another caller is refreshing the expired entry, look up again later
+    };
+
+    std::mutex           mutex;
+    StringMap<Entry>     entries;
+    std::chrono::seconds default_ttl     = std::chrono::minutes(10); // for services without expires
+    std::chrono::seconds refresh_window  = std::chrono::seconds(60);
+    std::chrono::seconds refresh_timeout = std::chrono::seconds(30); // another lookup refreshes if the refresher did not store by then
+
+    auto find(std::string_view host) -> Lookup;
+    // empty services only end the refresh, like abandon_refresh
+    auto store(std::string_view host, std::vector<Service> services) -> void;
+    // lets a later lookup refresh the entry, for when extdisco failed
+    auto abandon_refresh(std::string_view host) -> void;
+
+    static auto get() -> ServiceCache&;
+};
+} // namespace xmpp
@@ -0,0 +1,54 @@
+#include "stanza-template.hpp"
+#include "../macros/logger.hpp"
+#include "../util/charconv.hpp"
+#include "../xml-escape.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "../macros/unwrap.hpp"
+
+namespace xmpp {
+namespace {
+auto logger = Logger("xmpp");
+
+constexpr auto marker_head = std::string_view("@@slot");
+constexpr auto marker_tail = std::string_view("@@");
+} // namespace
+
+auto slot_marker(const size_t index) -> std::string {
+    return std::format("{}{}{}", marker_head, index, marker_tail);
+}
+
+auto StanzaTemplate::fill(std::string& buf, const std::initializer_list<std::string_view> values) const -> std::string_view {
+    ensure(values.size() >= slot_count, "template requires {} values, got {}", slot_count, values.size());
+    auto escaped = std::string();
+    buf.clear();
+    for(auto i = 0uz; i < slots.size(); i += 1) {
+        buf += literals[i];
+        buf += escape::xml_escape(values.begin()[slots[i]], escaped);
+    }
+    buf += literals.back();
+    return buf;
+}
+
+auto StanzaTemplate::create(const xml::Node& node) -> std::optional<StanzaTemplate> {
+    const auto str = xml::deparse(node);
+    auto       r   = StanzaTemplate{.slot_count = 0};
+    auto       pos = 0uz;
+    while(true) {
+        const auto head = str.find(marker_head, pos);
+        if(head == str.npos) {
+            r.literals.emplace_back(str.substr(pos));
+            break;
+        }
+        const auto index_begin = head + marker_head.size();
+        const auto tail        = str.find(marker_tail, index_begin);
+        ensure(tail != str.npos, "unterminated slot marker");
+        unwrap(index, from_chars<size_t>(std::string_view(str).substr(index_begin, tail - index_begin)));
+        r.literals.emplace_back(str.substr(pos, head - pos));
+        r.slots.push_back(index);
+        r.slot_count = std::max(r.slot_count, index + 1);
+        pos          = tail + marker_tail.size();
+    }
+    return r;
+}
+} // namespace xmpp
@@ -0,0 +1,25 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../xml/xml.hpp"
+
+namespace xmpp {
+// placeholder to put in attribute values or data of a template node
+auto slot_marker(size_t index) -> std::string;
+
+// stanza serialized once, later instances are made by splicing slot values into a reusable buffer
+struct StanzaTemplate {
+    std::vector<std::string> literals; // literals.size() == slots.size() + 1
+    std::vector<size_t>      slots;    // value index spliced between literals[i] and literals[i + 1]
+    size_t                   slot_count;
+
+    // values are escaped while splicing
+    // returns a view of buf, or an empty view if values does not cover every slot
+    auto fill(std::string& buf, std::initializer_list<std::string_view> values) const -> std::string_view;
+
+    static auto create(const xml::Node& node) -> std::optional<StanzaTemplate>;
+};
+} // namespace xmpp
@@ -0,0 +1,137 @@
+#include "stream-manager.hpp"
+#include "../macros/logger.hpp"
+#include "../util/charconv.hpp"
+#include "elements.hpp"
+
+#define CUTIL_MACROS_PRINT_FUNC(...) LOG_ERROR(logger, __VA_ARGS__)
+#include "../macros/unwrap.hpp"
+
+namespace xmpp {
+namespace {
+auto logger = Logger("xmpp-sm");
+
+// only these are counted, nonzas such as <r/> are not
+auto is_stanza_name(const std::string_view name) -> bool {
+    return name == "iq" || name == "presence" || name == "message";
+}
+
+auto get_payload_name(const std::string_view payload) -> std::string_view {
+    if(!payload.starts_with('<')) {
+        return {};
+    }
+    const auto end = payload.find_first_of(" \t\r\n/>", 1);
+    return payload.substr(1, end == payload.npos ? payload.npos : end - 1);
+}
+
+auto parse_h(const xmlview::Node& node) -> std::optional<uint32_t> {
+    unwrap(h_str, node.find_attr("h"));
+    unwrap(h, from_chars<uint32_t>(h_str));
+    return h;
+}
+} // namespace
+
+auto StreamManager::on_sent(const std::string_view payload) -> void {
+    if(!enabled || !is_stanza_name(get_payload_name(payload))) {
+        return;
+    }
+    unacked.emplace_back(payload);
+    outbound_count += 1;
+}
+
+auto StreamManager::on_received(const xmlview::Node& stanza, std::string& reply) -> bool {
+    count_received(stanza);
+    return handle_nonza(stanza, reply);
+}
+
+auto StreamManager::count_received(const xmlview::Node& stanza) -> void {
+    if(enabled && is_stanza_name(stanza.name)) {
+        inbound_count += 1;
+    }
+}
+
+auto StreamManager::handle_nonza(const xmlview::Node& node, std::string& reply) -> bool {
+    if(!enabled || !node.is_attr_equal("xmlns", ns::sm)) {
+        return false;
+    }
+    if(node.name == "r") {
+        reply = xml::deparse(elm::sm_answer.clone().append_attrs({{"h", std::to_string(inbound_count)}}));
+        return true;
+    }
+    if(node.name == "a") {
+        if(const auto h = parse_h(node); h) {
+            ack(*h);
+        }
+        ack_requested = false;
+        return true;
+    }
+    return false;
+}
+
+auto StreamManager::should_request_ack() const -> bool {
+    return enabled && !ack_requested && unacked.size() >= ack_request_threshold;
+}
+
+auto StreamManager::build_request() -> std::string {
+    ack_requested = true;
+    return xml::deparse(elm::sm_request);
+}
+
+auto StreamManager::build_enable() const -> std::string {
+    return xml::deparse(elm::sm_enable);
+}
+
+auto StreamManager::handle_enabled(const xmlview::Node& node) -> bool {
+    ensure(node.name == "enabled", "stream management not enabled: {}", node.name);
+    enabled        = true;
+    resumable      = node.is_attr_equal("resume", "true") || node.is_attr_equal("resume", "1");
+    inbound_count  = 0;
+    outbound_count = 0;
+    acked_count    = 0;
+    unacked.clear();
+    if(auto id = node.get_attr("id"); id) {
+        resumption_id = std::move(*id);
+    }
+    if(auto addr = node.get_attr("location"); addr) {
+        location = std::move(*addr);
+    }
+    if(const auto max = node.find_attr("max"); max) {
+        max_resumption_time = from_chars<uint32_t>(*max).value_or(0);
+    }
+    LOG_DEBUG(logger, "enabled resumable={} max={}", resumable, max_resumption_time);
+    return true;
+}
+
+auto StreamManager::build_resume() const -> std::string {
+    return xml::deparse(elm::sm_resume.clone().append_attrs({
+        {"h", std::to_string(inbound_count)},
+        {"previd", resumption_id},
+    }));
+}
+
+auto StreamManager::handle_resumed(const xmlview::Node& node) -> std::optional<std::vector<std::string>> {
+    if(node.name != "resumed") {
+        LOG_ERROR(logger, "resumption failed: {}", node.name);
+        // the session is gone, a new one starts counting from zero
+        enabled   = false;
+        resumable = false;
+        unacked.clear();
+        return std::nullopt;
+    }
+    unwrap(h, parse_h(node));
+    ensure(ack(h));
+    // the resent stanzas are counted again by on_sent
+    auto resend = std::vector<std::string>(std::make_move_iterator(unacked.begin()), std::make_move_iterator(unacked.end()));
+    unacked.clear();
+    outbound_count = h;
+    ack_requested  = false;
+    return resend;
+}
+
+auto StreamManager::ack(const uint32_t h) -> bool {
+    const auto count = uint32_t(h - acked_count);
+    ensure(count <= unacked.size(), "server acked {} stanzas, only {} were sent", count, unacked.size());
+    unacked.erase(unacked.begin(), unacked.begin() + count);
+    acked_count = h;
+    return true;
+}
+} // namespace xmpp
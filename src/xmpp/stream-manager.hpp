@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../xml-view.hpp"
+
+namespace xmpp {
+// xep-0198 stream management, sans-io
+// one instance per xmpp session, it outlives the websocket so that the session can be resumed on a new one
+// every stanza sent after enabling has to pass on_sent in wire order, and every received one on_received
+struct StreamManager {
+    // negotiated
+    bool        enabled   = false;
+    bool        resumable = false;
+    std::string resumption_id;
+    std::string location;                // preferred address to reconnect to, may be empty
+    uint32_t    max_resumption_time = 0; // seconds, 0 if the server did not tell
+
+    // counters wrap around at 2^32 as the xep says
+    uint32_t                inbound_count  = 0; // stanzas received, the h we report
+    uint32_t                outbound_count = 0; // stanzas sent
+    uint32_t                acked_count    = 0; // the last h the server reported
+    std::deque<std::string> unacked;            // sent stanzas the server has not acknowledged yet, oldest first
+    bool                    ack_requested         = false;
+    size_t                  ack_request_threshold = 5; // request an ack once this many stanzas are unacked
+
+    auto on_sent(std::string_view payload) -> void;
+    // count_received and handle_nonza
+    auto on_received(const xmlview::Node& stanza, std::string& reply) -> bool;
+    // counts iqs, presences and messages, call exactly once per received stanza
+    auto count_received(const xmlview::Node& stanza) -> void;
+    // returns true if node was a stream management element and is consumed
+    // reply is set if it has to be answered
+    auto handle_nonza(const xmlview::Node& node, std::string& reply) -> bool;
+    auto should_request_ack() const -> bool;
+    auto build_request() -> std::string;
+    auto build_enable() const -> std::string;
+    auto handle_enabled(const xmlview::Node& enabled) -> bool;
+    auto build_resume() const -> std::string;
+    // returns the stanzas which the server did not receive before the connection was lost
+    // they have to be sent again, through on_sent
+    auto handle_resumed(const xmlview::Node& resumed) -> std::optional<std::vector<std::string>>;
+    auto ack(uint32_t h) -> bool;
+};
+} // namespace xmpp